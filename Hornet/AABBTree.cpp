@@ -0,0 +1,395 @@
+#include "AABBTree.h"
+#include <cmath>
+
+const double AABBTree::DEFAULTMARGIN = 32.0;
+
+bool AABBTree::TreeBox::SegmentEntry(const Vector2D& start, const Vector2D& delta, double& entry) const
+{
+	double tMin = 0.0;
+	double tMax = 1.0;
+
+	const double starts[2] = { start.XValue, start.YValue };
+	const double deltas[2] = { delta.XValue, delta.YValue };
+	const double mins[2] = { minX, minY };
+	const double maxes[2] = { maxX, maxY };
+
+	// Clip the segment against each pair of parallel sides in turn
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		if (std::fabs(deltas[axis]) < 1e-12)
+		{
+			// Parallel to these sides, so must already be between them
+			if (starts[axis] < mins[axis] || starts[axis] > maxes[axis])
+				return false;
+		}
+		else
+		{
+			double t1 = (mins[axis] - starts[axis]) / deltas[axis];
+			double t2 = (maxes[axis] - starts[axis]) / deltas[axis];
+			if (t1 > t2)
+				std::swap(t1, t2);
+			tMin = std::max(tMin, t1);
+			tMax = std::min(tMax, t2);
+			if (tMin > tMax)
+				return false;
+		}
+	}
+	entry = tMin;
+	return true;
+}
+
+AABBTree::AABBTree()
+{
+	m_root = NULLPROXY;
+	m_freeList = NULLPROXY;
+	m_numProxies = 0;
+	m_margin = DEFAULTMARGIN;
+}
+
+AABBTree::TreeBox AABBTree::ToTreeBox(const Rectangle2D& box, double margin)
+{
+	return { box.GetBottomLeft().XValue - margin, box.GetBottomLeft().YValue - margin,
+		box.GetTopRight().XValue + margin, box.GetTopRight().YValue + margin };
+}
+
+int AABBTree::AllocateNode()
+{
+	if (m_freeList == NULLPROXY)
+	{
+		m_nodes.emplace_back();
+		m_nodes.back().parent = NULLPROXY;
+		m_freeList = (int)m_nodes.size() - 1;
+	}
+
+	int node = m_freeList;
+	m_freeList = m_nodes[node].parent;
+	m_nodes[node].parent = NULLPROXY;
+	m_nodes[node].child1 = NULLPROXY;
+	m_nodes[node].child2 = NULLPROXY;
+	m_nodes[node].height = 0;
+	m_nodes[node].pObject = nullptr;
+	return node;
+}
+
+void AABBTree::FreeNode(int node)
+{
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].height = -1;
+	m_nodes[node].pObject = nullptr;
+	m_freeList = node;
+}
+
+int AABBTree::CreateProxy(const Rectangle2D& box, GameObject* pObject)
+{
+	int proxy = AllocateNode();
+	m_nodes[proxy].box = ToTreeBox(box, m_margin);
+	m_nodes[proxy].pObject = pObject;
+	InsertLeaf(proxy);
+	++m_numProxies;
+	return proxy;
+}
+
+void AABBTree::DestroyProxy(int proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	--m_numProxies;
+}
+
+bool AABBTree::MoveProxy(int proxy, const Rectangle2D& box)
+{
+	TreeBox tight = ToTreeBox(box, 0);
+	if (m_nodes[proxy].box.Contains(tight))
+		return false;
+
+	RemoveLeaf(proxy);
+	m_nodes[proxy].box = ToTreeBox(box, m_margin);
+	InsertLeaf(proxy);
+	return true;
+}
+
+GameObject* AABBTree::GetObject(int proxy) const
+{
+	return m_nodes[proxy].pObject;
+}
+
+const AABBTree::TreeBox& AABBTree::GetFatBox(int proxy) const
+{
+	return m_nodes[proxy].box;
+}
+
+void AABBTree::Clear()
+{
+	m_nodes.clear();
+	m_root = NULLPROXY;
+	m_freeList = NULLPROXY;
+	m_numProxies = 0;
+}
+
+void AABBTree::SetMargin(double margin)
+{
+	if (margin >= 0)
+		m_margin = margin;
+}
+
+double AABBTree::GetMargin() const
+{
+	return m_margin;
+}
+
+int AABBTree::GetHeight() const
+{
+	if (m_root == NULLPROXY)
+		return 0;
+	return m_nodes[m_root].height;
+}
+
+int AABBTree::GetNumProxies() const
+{
+	return m_numProxies;
+}
+
+int AABBTree::GetCapacity() const
+{
+	return (int)m_nodes.size();
+}
+
+void AABBTree::InsertLeaf(int leaf)
+{
+	if (m_root == NULLPROXY)
+	{
+		m_root = leaf;
+		m_nodes[leaf].parent = NULLPROXY;
+		return;
+	}
+
+	// Walk down the tree to find the best sibling for the new leaf.
+	// The cost of a choice is the increase in the total perimeter of the boxes.
+	TreeBox leafBox = m_nodes[leaf].box;
+	int index = m_root;
+	while (!m_nodes[index].IsLeaf())
+	{
+		int child1 = m_nodes[index].child1;
+		int child2 = m_nodes[index].child2;
+
+		double perimeter = m_nodes[index].box.Perimeter();
+		double combinedPerimeter = TreeBox::Combine(m_nodes[index].box, leafBox).Perimeter();
+
+		// Cost of making a new parent for this node and the new leaf
+		double cost = 2.0 * combinedPerimeter;
+
+		// Minimum cost of pushing the leaf further down the tree
+		double inheritanceCost = 2.0 * (combinedPerimeter - perimeter);
+
+		double cost1 = TreeBox::Combine(leafBox, m_nodes[child1].box).Perimeter() + inheritanceCost;
+		if (!m_nodes[child1].IsLeaf())
+			cost1 -= m_nodes[child1].box.Perimeter();
+
+		double cost2 = TreeBox::Combine(leafBox, m_nodes[child2].box).Perimeter() + inheritanceCost;
+		if (!m_nodes[child2].IsLeaf())
+			cost2 -= m_nodes[child2].box.Perimeter();
+
+		if (cost < cost1 && cost < cost2)
+			break;
+
+		index = (cost1 < cost2) ? child1 : child2;
+	}
+
+	// Create a new parent for the sibling and the leaf
+	int sibling = index;
+	int oldParent = m_nodes[sibling].parent;
+	int newParent = AllocateNode();
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].box = TreeBox::Combine(leafBox, m_nodes[sibling].box);
+	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+
+	if (oldParent != NULLPROXY)
+	{
+		if (m_nodes[oldParent].child1 == sibling)
+			m_nodes[oldParent].child1 = newParent;
+		else
+			m_nodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		m_root = newParent;
+	}
+	m_nodes[newParent].child1 = sibling;
+	m_nodes[newParent].child2 = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	// Walk back up the tree fixing heights and boxes
+	index = m_nodes[leaf].parent;
+	while (index != NULLPROXY)
+	{
+		index = Balance(index);
+
+		int child1 = m_nodes[index].child1;
+		int child2 = m_nodes[index].child2;
+		m_nodes[index].height = 1 + std::max(m_nodes[child1].height, m_nodes[child2].height);
+		m_nodes[index].box = TreeBox::Combine(m_nodes[child1].box, m_nodes[child2].box);
+
+		index = m_nodes[index].parent;
+	}
+}
+
+void AABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = NULLPROXY;
+		return;
+	}
+
+	int parent = m_nodes[leaf].parent;
+	int grandParent = m_nodes[parent].parent;
+	int sibling = (m_nodes[parent].child1 == leaf) ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+	if (grandParent != NULLPROXY)
+	{
+		// Replace the parent with the sibling
+		if (m_nodes[grandParent].child1 == parent)
+			m_nodes[grandParent].child1 = sibling;
+		else
+			m_nodes[grandParent].child2 = sibling;
+		m_nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+
+		// Walk back up the tree fixing heights and boxes
+		int index = grandParent;
+		while (index != NULLPROXY)
+		{
+			index = Balance(index);
+
+			int child1 = m_nodes[index].child1;
+			int child2 = m_nodes[index].child2;
+			m_nodes[index].box = TreeBox::Combine(m_nodes[child1].box, m_nodes[child2].box);
+			m_nodes[index].height = 1 + std::max(m_nodes[child1].height, m_nodes[child2].height);
+
+			index = m_nodes[index].parent;
+		}
+	}
+	else
+	{
+		m_root = sibling;
+		m_nodes[sibling].parent = NULLPROXY;
+		FreeNode(parent);
+	}
+}
+
+int AABBTree::Balance(int iA)
+{
+	Node& A = m_nodes[iA];
+	if (A.IsLeaf() || A.height < 2)
+		return iA;
+
+	int iB = A.child1;
+	int iC = A.child2;
+	Node& B = m_nodes[iB];
+	Node& C = m_nodes[iC];
+
+	int balance = C.height - B.height;
+
+	// Rotate C up
+	if (balance > 1)
+	{
+		int iF = C.child1;
+		int iG = C.child2;
+		Node& F = m_nodes[iF];
+		Node& G = m_nodes[iG];
+
+		// Swap A and C
+		C.child1 = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+
+		// A's old parent should point to C
+		if (C.parent != NULLPROXY)
+		{
+			if (m_nodes[C.parent].child1 == iA)
+				m_nodes[C.parent].child1 = iC;
+			else
+				m_nodes[C.parent].child2 = iC;
+		}
+		else
+		{
+			m_root = iC;
+		}
+
+		// Keep the taller of F and G under C
+		if (F.height > G.height)
+		{
+			C.child2 = iF;
+			A.child2 = iG;
+			G.parent = iA;
+			A.box = TreeBox::Combine(B.box, G.box);
+			C.box = TreeBox::Combine(A.box, F.box);
+			A.height = 1 + std::max(B.height, G.height);
+			C.height = 1 + std::max(A.height, F.height);
+		}
+		else
+		{
+			C.child2 = iG;
+			A.child2 = iF;
+			F.parent = iA;
+			A.box = TreeBox::Combine(B.box, F.box);
+			C.box = TreeBox::Combine(A.box, G.box);
+			A.height = 1 + std::max(B.height, F.height);
+			C.height = 1 + std::max(A.height, G.height);
+		}
+		return iC;
+	}
+
+	// Rotate B up
+	if (balance < -1)
+	{
+		int iD = B.child1;
+		int iE = B.child2;
+		Node& D = m_nodes[iD];
+		Node& E = m_nodes[iE];
+
+		// Swap A and B
+		B.child1 = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+
+		// A's old parent should point to B
+		if (B.parent != NULLPROXY)
+		{
+			if (m_nodes[B.parent].child1 == iA)
+				m_nodes[B.parent].child1 = iB;
+			else
+				m_nodes[B.parent].child2 = iB;
+		}
+		else
+		{
+			m_root = iB;
+		}
+
+		// Keep the taller of D and E under B
+		if (D.height > E.height)
+		{
+			B.child2 = iD;
+			A.child1 = iE;
+			E.parent = iA;
+			A.box = TreeBox::Combine(C.box, E.box);
+			B.box = TreeBox::Combine(A.box, D.box);
+			A.height = 1 + std::max(C.height, E.height);
+			B.height = 1 + std::max(A.height, D.height);
+		}
+		else
+		{
+			B.child2 = iE;
+			A.child1 = iD;
+			D.parent = iA;
+			A.box = TreeBox::Combine(C.box, D.box);
+			B.box = TreeBox::Combine(A.box, E.box);
+			A.height = 1 + std::max(C.height, D.height);
+			B.height = 1 + std::max(A.height, E.height);
+		}
+		return iB;
+	}
+
+	return iA;
+}
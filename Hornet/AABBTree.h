@@ -0,0 +1,329 @@
+#pragma once
+#include "Shapes.h"
+#include <vector>
+#include <algorithm>
+
+class GameObject;
+
+// A stack that starts in a fixed array, so searches normally need no allocation,
+// but moves to the heap if it runs out of space rather than dropping items.
+// Used by the AABBTree searches. Data() gives the items in order from the bottom,
+// so the stack can also be used as storage for std::push_heap and std::pop_heap.
+template<typename T, int N>
+class GrowableStack
+{
+public:
+	GrowableStack() : m_pData(m_array), m_count(0), m_capacity(N)
+	{
+	}
+
+	GrowableStack(const GrowableStack&) = delete;
+	GrowableStack& operator=(const GrowableStack&) = delete;
+
+	void Push(const T& item)
+	{
+		if (m_count == m_capacity)
+			Grow();
+		m_pData[m_count++] = item;
+	}
+
+	T Pop()
+	{
+		return m_pData[--m_count];
+	}
+
+	int GetCount() const
+	{
+		return m_count;
+	}
+
+	T* Data()
+	{
+		return m_pData;
+	}
+
+private:
+	void Grow()
+	{
+		if (m_pData == m_array)
+			m_overflow.assign(m_array, m_array + m_count);
+		m_capacity *= 2;
+		m_overflow.resize(m_capacity);
+		m_pData = m_overflow.data();
+	}
+
+	T m_array[N];
+	std::vector<T> m_overflow;	// Only used once the array is full
+	T* m_pData;
+	int m_count;
+	int m_capacity;
+};
+
+// A dynamic bounding volume hierarchy. Each object is stored in a leaf
+// with a bounding box, and each branch stores a box enclosing both its children.
+// Searches can skip any branch whose box does not match, so most queries
+// only visit a small part of the tree, even when objects are very different sizes.
+//
+// The box stored for each object is "fattened" by a margin. An object only
+// has to be moved within the tree once it leaves its fattened box, so objects
+// that move a little each frame cost very little.
+// The tree is kept balanced using rotations as objects are inserted and removed.
+//
+// Boxes are stored as fattened boxes, so the results of searches may include objects
+// that are close to the search area, but not in it. Callers should check the results.
+class AABBTree
+{
+public:
+	// A proxy that does not exist
+	static const int NULLPROXY = -1;
+
+	// The default margin added to each side of a box
+	static const double DEFAULTMARGIN;
+
+	// Orthogonally-aligned box used internally by the tree.
+	// Lighter than Rectangle2D, since the tree stores a great many of these.
+	struct TreeBox
+	{
+		double minX;
+		double minY;
+		double maxX;
+		double maxY;
+
+		// Returns the box enclosing both boxes
+		static TreeBox Combine(const TreeBox& a, const TreeBox& b)
+		{
+			return { std::min(a.minX, b.minX), std::min(a.minY, b.minY),
+				std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY) };
+		}
+
+		// Returns the perimeter. Used to decide where to insert new leaves.
+		double Perimeter() const
+		{
+			return 2.0 * ((maxX - minX) + (maxY - minY));
+		}
+
+		// Returns true if the other box is entirely inside this one
+		bool Contains(const TreeBox& other) const
+		{
+			return minX <= other.minX && minY <= other.minY
+				&& other.maxX <= maxX && other.maxY <= maxY;
+		}
+
+		// Returns true if the boxes overlap or touch
+		bool Overlaps(const TreeBox& other) const
+		{
+			return minX <= other.maxX && other.minX <= maxX
+				&& minY <= other.maxY && other.minY <= maxY;
+		}
+
+		// Returns the square of the distance from the point to the nearest
+		// part of the box. Zero if the point is inside the box.
+		double DistanceSquared(const Vector2D& point) const
+		{
+			double dx = std::max(std::max(minX - point.XValue, 0.0), point.XValue - maxX);
+			double dy = std::max(std::max(minY - point.YValue, 0.0), point.YValue - maxY);
+			return dx * dx + dy * dy;
+		}
+
+		// Finds where a segment from start to start+delta enters the box.
+		// Returns false if it misses the box. Otherwise sets entry to the
+		// fraction of the way along the segment (0 if start is inside the box)
+		bool SegmentEntry(const Vector2D& start, const Vector2D& delta, double& entry) const;
+	};
+
+	AABBTree();
+
+	// Adds an object to the tree and returns the proxy used to refer to it.
+	// "box" - The object's bounding box. The tree stores a fattened copy.
+	// "pObject" - The object
+	int CreateProxy(const Rectangle2D& box, GameObject* pObject);
+
+	// Removes a proxy from the tree
+	void DestroyProxy(int proxy);
+
+	// Updates the bounding box of an object. The tree is only changed if the new box is not
+	// inside the fattened box already stored.
+	// Returns true if the object had to be moved in the tree.
+	bool MoveProxy(int proxy, const Rectangle2D& box);
+
+	// Returns the object stored with the proxy
+	GameObject* GetObject(int proxy) const;
+
+	// Returns the fattened box stored for the proxy
+	const TreeBox& GetFatBox(int proxy) const;
+
+	// Removes all proxies
+	void Clear();
+
+	// Sets the distance each box is fattened by. Only affects boxes added or moved afterwards.
+	void SetMargin(double margin);
+
+	// Returns the distance each box is fattened by
+	double GetMargin() const;
+
+	// Returns the height of the tree. A balanced tree of n objects has a height of about log2(n)
+	int GetHeight() const;
+
+	// Returns the number of objects in the tree
+	int GetNumProxies() const;
+
+	// Returns one more than the largest proxy number that might be in use.
+	// Useful for sizing lookup tables indexed by proxy.
+	int GetCapacity() const;
+
+	// Calls callback(proxy) for each proxy whose fattened box overlaps the box.
+	// The search stops early if the callback returns false.
+	template<typename Callback>
+	void Query(const Rectangle2D& box, Callback callback) const
+	{
+		TreeBox target = ToTreeBox(box, 0);
+		GrowableStack<int, STACKSIZE> stack;
+		if (m_root != NULLPROXY)
+			stack.Push(m_root);
+
+		while (stack.GetCount() > 0)
+		{
+			int index = stack.Pop();
+			const Node& node = m_nodes[index];
+			if (!node.box.Overlaps(target))
+				continue;
+
+			if (node.IsLeaf())
+			{
+				if (!callback(index))
+					return;
+			}
+			else
+			{
+				stack.Push(node.child1);
+				stack.Push(node.child2);
+			}
+		}
+	}
+
+	// Calls callback(proxy, entry) for each proxy whose fattened box is crossed by the segment.
+	// "entry" is the fraction of the way along the segment where it enters the box.
+	// Proxies are not visited in any particular order.
+	// The search stops early if the callback returns false.
+	template<typename Callback>
+	void RayCast(const Segment2D& segment, Callback callback) const
+	{
+		Vector2D start = segment.GetStart();
+		Vector2D delta = segment.GetEnd() - start;
+		GrowableStack<int, STACKSIZE> stack;
+		if (m_root != NULLPROXY)
+			stack.Push(m_root);
+
+		while (stack.GetCount() > 0)
+		{
+			int index = stack.Pop();
+			const Node& node = m_nodes[index];
+			double entry;
+			if (!node.box.SegmentEntry(start, delta, entry))
+				continue;
+
+			if (node.IsLeaf())
+			{
+				if (!callback(index, entry))
+					return;
+			}
+			else
+			{
+				stack.Push(node.child1);
+				stack.Push(node.child2);
+			}
+		}
+	}
+
+	// Visits proxies in order of the distance from the point to their fattened box, nearest first.
+	// callback(proxy) is called for each, and must return the square of the
+	// furthest distance still worth searching (for example, the square of the distance to
+	// the nearest suitable object found so far). The search stops once no remaining box is
+	// that close. The search starts with a limit of "maxDistanceSquared".
+	template<typename Callback>
+	void Nearest(const Vector2D& point, double maxDistanceSquared, Callback callback) const
+	{
+		struct Candidate
+		{
+			double distanceSquared;
+			int node;
+			bool operator<(const Candidate& other) const
+			{
+				// Reversed so the heap gives the nearest first
+				return distanceSquared > other.distanceSquared;
+			}
+		};
+
+		if (m_root == NULLPROXY)
+			return;
+
+		GrowableStack<Candidate, STACKSIZE> heap;
+		heap.Push({ m_nodes[m_root].box.DistanceSquared(point), m_root });
+
+		double limit = maxDistanceSquared;
+		while (heap.GetCount() > 0)
+		{
+			std::pop_heap(heap.Data(), heap.Data() + heap.GetCount());
+			Candidate next = heap.Pop();
+
+			if (next.distanceSquared > limit)
+				return;
+
+			const Node& node = m_nodes[next.node];
+			if (node.IsLeaf())
+			{
+				limit = callback(next.node);
+			}
+			else
+			{
+				for (int child : { node.child1, node.child2 })
+				{
+					double distanceSquared = m_nodes[child].box.DistanceSquared(point);
+					if (distanceSquared <= limit)
+					{
+						heap.Push({ distanceSquared, child });
+						std::push_heap(heap.Data(), heap.Data() + heap.GetCount());
+					}
+				}
+			}
+		}
+	}
+
+private:
+	// Size of the fixed part of the search stacks. Far more than a balanced tree
+	// will ever need. The stacks move to the heap if it is ever exceeded.
+	static const int STACKSIZE = 256;
+
+	struct Node
+	{
+		TreeBox box;
+		GameObject* pObject;	// The object, for leaves. nullptr for branches
+		int parent;				// Parent node. Next free node if this node is not in use
+		int child1;				// NULLPROXY for leaves
+		int child2;				// NULLPROXY for leaves
+		int height;				// 0 for leaves, -1 if not in use
+
+		bool IsLeaf() const
+		{
+			return child1 == NULLPROXY;
+		}
+	};
+
+	std::vector<Node> m_nodes;
+	int m_root;
+	int m_freeList;				// The first unused node
+	int m_numProxies;
+	double m_margin;
+
+	int AllocateNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+
+	// Performs a rotation at the node if it is unbalanced.
+	// Returns the node that is now in its place.
+	int Balance(int node);
+
+	// Converts a rectangle to a box, adding the margin to each side
+	static TreeBox ToTreeBox(const Rectangle2D& box, double margin);
+};
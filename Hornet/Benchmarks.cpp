@@ -0,0 +1,352 @@
+#include "Benchmarks.h"
+#include "GameObject.h"
+#include "Shapes.h"
+#include "AABBTree.h"
+#include "SDL.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <list>
+#include <random>
+#include <typeinfo>
+
+// Number of times each pass is timed. The fastest is used, because it is the
+// least affected by other programs.
+const int REPEATS = 5;
+
+// Numbers of objects used by the iteration benchmark
+const int ITERATIONSIZES[] = { 1000, 10000, 100000 };
+
+// Number of shapes, and of tests between them, used by the dispatch benchmark
+const int DISPATCHSHAPES = 1000;
+const int DISPATCHTESTS = 100000;
+
+// Numbers of objects, the number of neighbours to find, and the
+// number of searches, used by the nearest-neighbour benchmark
+const int NEARESTSIZES[] = { 1000, 10000, 100000 };
+const int NEARESTK = 8;
+const int NEARESTSEARCHES = 200;
+
+// Results of the timed work are added to this, so the compiler cannot remove the work
+static volatile double s_sink = 0;
+
+// A plain object that can be placed anywhere
+class BenchmarkObject : public GameObject
+{
+public:
+	explicit BenchmarkObject(Vector2D position) : GameObject(ObjectType::UNKNOWN)
+	{
+		m_position = position;
+	}
+};
+
+// The test used before shapes had a kind. Each class's Intersects() compared the
+// type of the other shape with each concrete type in turn, then used dynamic_cast.
+template<typename Shape>
+static bool IntersectsByTypeid(const Shape& shape, const IShape2D& other)
+{
+	if (typeid(other) == typeid(Rectangle2D))
+		return dynamic_cast<const Rectangle2D*>(&other)->Intersects(shape);
+	if (typeid(other) == typeid(Circle2D))
+		return dynamic_cast<const Circle2D*>(&other)->Intersects(shape);
+	if (typeid(other) == typeid(Segment2D))
+		return dynamic_cast<const Segment2D*>(&other)->Intersects(shape);
+	if (typeid(other) == typeid(Point2D))
+		return dynamic_cast<const Point2D*>(&other)->Intersects(shape);
+	if (typeid(other) == typeid(Rectangle2D))
+		return dynamic_cast<const Rectangle2D*>(&other)->Intersects(shape);
+	if (typeid(other) == typeid(AngledRectangle2D))
+		return dynamic_cast<const AngledRectangle2D*>(&other)->Intersects(shape);
+	return false;
+}
+
+// Chooses the class of the first shape, as the virtual call to Intersects() did
+static bool IntersectsByTypeid(const IShape2D& first, const IShape2D& second)
+{
+	switch (first.GetKind())
+	{
+	case ShapeKind::POINT:
+		return IntersectsByTypeid(static_cast<const Point2D&>(first), second);
+	case ShapeKind::SEGMENT:
+		return IntersectsByTypeid(static_cast<const Segment2D&>(first), second);
+	case ShapeKind::CIRCLE:
+		return IntersectsByTypeid(static_cast<const Circle2D&>(first), second);
+	case ShapeKind::RECTANGLE:
+		return IntersectsByTypeid(static_cast<const Rectangle2D&>(first), second);
+	case ShapeKind::ANGLEDRECTANGLE:
+		return IntersectsByTypeid(static_cast<const AngledRectangle2D&>(first), second);
+	}
+	return false;
+}
+
+// Keeps "pNext" if it is one of the "k" objects nearest to "location" found so far.
+// "results" is a heap holding "numResults" objects, with the furthest at the top.
+// Returns the square of the distance that other objects must be within to be kept.
+// Works the same way as ObjectManager::FindKNearestObjects().
+static double KeepNearest(GameObject** results, int& numResults, int k, GameObject* pNext, const Vector2D& location)
+{
+	auto closer = [&location](GameObject* pA, GameObject* pB)
+		{
+			return (pA->GetPosition() - location).magnitudeSquared() < (pB->GetPosition() - location).magnitudeSquared();
+		};
+
+	if (numResults < k)
+	{
+		results[numResults] = pNext;
+		++numResults;
+		std::push_heap(results, results + numResults, closer);
+	}
+	else if (closer(pNext, results[0]))
+	{
+		std::pop_heap(results, results + k, closer);
+		results[k - 1] = pNext;
+		std::push_heap(results, results + k, closer);
+	}
+	return (numResults < k) ? 9e9 : (results[0]->GetPosition() - location).magnitudeSquared();
+}
+
+// Returns the fastest time taken by pass(), in nanoseconds
+template<typename Pass>
+static double Fastest(Pass pass)
+{
+	double best = 0;
+	for (int i = 0; i < REPEATS; ++i)
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+		pass();
+		double time = (SDL_GetPerformanceCounter() - start) * 1e9 / SDL_GetPerformanceFrequency();
+		if (i == 0 || time < best)
+			best = time;
+	}
+	return best;
+}
+
+// Formats a line of results
+template<typename... Values>
+static std::string Format(const char* format, Values... values)
+{
+	char line[128];
+	std::snprintf(line, sizeof(line), format, values...);
+	return line;
+}
+
+std::vector<std::string> Benchmarks::RunAll()
+{
+	std::vector<std::string> results;
+
+	for (int numObjects : ITERATIONSIZES)
+	{
+		double vectorTime, listTime;
+		TimeObjectIteration(numObjects, vectorTime, listTime);
+		results.push_back(Format("Iterate %d objects: vector %.2f ns, list %.2f ns each", numObjects, vectorTime, listTime));
+	}
+
+	double tableTime, typeidTime;
+	TimeShapeDispatch(DISPATCHTESTS, tableTime, typeidTime);
+	results.push_back(Format("Test %d shape pairs: table %.2f ns, typeid %.2f ns each", DISPATCHTESTS, tableTime, typeidTime));
+
+	for (int numObjects : NEARESTSIZES)
+	{
+		double treeTime, scanTime;
+		bool same = TimeNearestSearch(numObjects, NEARESTK, treeTime, scanTime);
+		results.push_back(Format("Find %d nearest of %d: tree %.2f us, scan %.2f us each", NEARESTK, numObjects, treeTime, scanTime));
+		if (!same)
+			results.push_back("Tree and scan found different nearest objects");
+	}
+
+	return results;
+}
+
+void Benchmarks::TimeObjectIteration(int numObjects, double& vectorTime, double& listTime)
+{
+	std::mt19937 random(numObjects);
+	std::uniform_real_distribution<double> coordinate(-1000, 1000);
+
+	// Built in the same loop, as the old AddItem did, so each list node
+	// is allocated between the objects
+	std::vector<GameObject*> objectVector;
+	std::list<GameObject*> objectList;
+	objectVector.reserve(numObjects);
+	for (int i = 0; i < numObjects; ++i)
+	{
+		GameObject* pObject = new BenchmarkObject(Vector2D(coordinate(random), coordinate(random)));
+		objectVector.push_back(pObject);
+		objectList.push_back(pObject);
+	}
+
+	vectorTime = Fastest([&objectVector]()
+		{
+			double total = 0;
+			for (size_t i = 0; i < objectVector.size(); ++i)
+			{
+				GameObject* pNext = objectVector[i];
+				if (pNext->IsActive())
+					total += pNext->GetPosition().XValue;
+			}
+			s_sink = s_sink + total;
+		}) / numObjects;
+
+	listTime = Fastest([&objectList]()
+		{
+			double total = 0;
+			for (GameObject* pNext : objectList)
+			{
+				if (pNext->IsActive())
+					total += pNext->GetPosition().XValue;
+			}
+			s_sink = s_sink + total;
+		}) / numObjects;
+
+	for (GameObject* pNext : objectVector)
+	{
+		delete pNext;
+	}
+}
+
+void Benchmarks::TimeShapeDispatch(int numTests, double& tableTime, double& typeidTime)
+{
+	std::mt19937 random(numTests);
+	std::uniform_real_distribution<double> coordinate(-1000, 1000);
+	std::uniform_real_distribution<double> size(10, 100);
+	std::uniform_int_distribution<int> kind(0, 4);
+	std::uniform_int_distribution<int> pick(0, DISPATCHSHAPES - 1);
+
+	// A random mix of all five kinds
+	std::vector<IShape2D*> shapes;
+	shapes.reserve(DISPATCHSHAPES);
+	for (int i = 0; i < DISPATCHSHAPES; ++i)
+	{
+		Vector2D position(coordinate(random), coordinate(random));
+		double width = size(random);
+		double height = size(random);
+		switch ((ShapeKind)kind(random))
+		{
+		case ShapeKind::POINT:
+			shapes.push_back(new Point2D(position));
+			break;
+		case ShapeKind::SEGMENT:
+		{
+			Segment2D* pSegment = new Segment2D();
+			pSegment->PlaceAt(position, position + Vector2D(width, height));
+			shapes.push_back(pSegment);
+			break;
+		}
+		case ShapeKind::CIRCLE:
+			shapes.push_back(new Circle2D(position, width));
+			break;
+		case ShapeKind::RECTANGLE:
+			shapes.push_back(new Rectangle2D(position, position + Vector2D(width, height)));
+			break;
+		case ShapeKind::ANGLEDRECTANGLE:
+		{
+			AngledRectangle2D* pRectangle = new AngledRectangle2D(position, height, width);
+			pRectangle->SetAngle(coordinate(random));
+			shapes.push_back(pRectangle);
+			break;
+		}
+		}
+	}
+
+	std::vector<std::pair<int, int>> tests(numTests);
+	for (std::pair<int, int>& next : tests)
+	{
+		next.first = pick(random);
+		next.second = pick(random);
+	}
+
+	tableTime = Fastest([&]()
+		{
+			int hits = 0;
+			for (const std::pair<int, int>& next : tests)
+			{
+				if (shapes[next.first]->Intersects(*shapes[next.second]))
+					++hits;
+			}
+			s_sink = s_sink + hits;
+		}) / numTests;
+
+	typeidTime = Fastest([&]()
+		{
+			int hits = 0;
+			for (const std::pair<int, int>& next : tests)
+			{
+				if (IntersectsByTypeid(*shapes[next.first], *shapes[next.second]))
+					++hits;
+			}
+			s_sink = s_sink + hits;
+		}) / numTests;
+
+	for (IShape2D* pNext : shapes)
+	{
+		delete pNext;
+	}
+}
+
+bool Benchmarks::TimeNearestSearch(int numObjects, int k, double& treeTime, double& scanTime)
+{
+	std::mt19937 random(numObjects);
+	// Keeps about the same number of objects in each part of the area, whatever the number of objects
+	double range = 10 * std::sqrt((double)numObjects);
+	std::uniform_real_distribution<double> coordinate(-range, range);
+
+	std::vector<GameObject*> objects;
+	AABBTree tree;
+	objects.reserve(numObjects);
+	for (int i = 0; i < numObjects; ++i)
+	{
+		Vector2D position(coordinate(random), coordinate(random));
+		GameObject* pObject = new BenchmarkObject(position);
+		objects.push_back(pObject);
+		tree.CreateProxy(Rectangle2D(position, position), pObject);
+	}
+
+	std::vector<Vector2D> locations(NEARESTSEARCHES);
+	for (Vector2D& next : locations)
+	{
+		next.set(coordinate(random), coordinate(random));
+	}
+
+	// The results of the last search from each location, so the two methods can be compared
+	std::vector<GameObject*> treeResults(NEARESTSEARCHES * k);
+	std::vector<GameObject*> scanResults(NEARESTSEARCHES * k);
+
+	treeTime = Fastest([&]()
+		{
+			for (int i = 0; i < NEARESTSEARCHES; ++i)
+			{
+				GameObject** results = &treeResults[i * k];
+				int numResults = 0;
+				tree.Nearest(locations[i], 9e9, [&](int proxy)
+					{
+						return KeepNearest(results, numResults, k, tree.GetObject(proxy), locations[i]);
+					});
+			}
+		}) / (1000.0 * NEARESTSEARCHES);
+
+	scanTime = Fastest([&]()
+		{
+			for (int i = 0; i < NEARESTSEARCHES; ++i)
+			{
+				GameObject** results = &scanResults[i * k];
+				int numResults = 0;
+				for (GameObject* pNext : objects)
+				{
+					KeepNearest(results, numResults, k, pNext, locations[i]);
+				}
+			}
+		}) / (1000.0 * NEARESTSEARCHES);
+
+	// The heaps may be in different orders, so compare the sets of objects found
+	for (int i = 0; i < NEARESTSEARCHES; ++i)
+	{
+		std::sort(treeResults.begin() + i * k, treeResults.begin() + (i + 1) * k);
+		std::sort(scanResults.begin() + i * k, scanResults.begin() + (i + 1) * k);
+	}
+	bool same = (treeResults == scanResults);
+
+	for (GameObject* pNext : objects)
+	{
+		delete pNext;
+	}
+	return same;
+}
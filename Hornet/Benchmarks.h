@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Times parts of the engine against the simpler code they replaced, so that
+// the difference can be checked on the machine the game runs on.
+// Run them with F9 while the ObjectManager debug display is on. The results are
+// shown on the debug display and written to the error log.
+// Times are best measured in a Release build.
+class Benchmarks
+{
+public:
+	// Runs all the benchmarks. Returns one line of text for each result.
+	// Takes a few seconds, during which the game does not update.
+	static std::vector<std::string> RunAll();
+
+	// Times a pass over "numObjects" objects, reading the position of each active one.
+	// "vectorTime" is for a vector of pointers, as ObjectManager stores objects now.
+	// "listTime" is for a std::list of pointers, as it stored them before.
+	// Times are in nanoseconds per object.
+	static void TimeObjectIteration(int numObjects, double& vectorTime, double& listTime);
+
+	// Times "numTests" intersection tests between random pairs of shapes of all kinds.
+	// "tableTime" is for IShape2D::Intersects(), which looks up the test in a table.
+	// "typeidTime" is for the chain of typeid comparisons and dynamic_casts it replaced.
+	// Times are in nanoseconds per test.
+	static void TimeShapeDispatch(int numTests, double& tableTime, double& typeidTime);
+
+	// Times searches for the "k" objects nearest to random points, among "numObjects" objects.
+	// "treeTime" is for a best-first search of an AABBTree, as FindKNearestObjects() uses.
+	// "scanTime" is for checking every object.
+	// Returns false if the two searches did not find the same objects.
+	// Times are in microseconds per search.
+	static bool TimeNearestSearch(int numObjects, int k, double& treeTime, double& scanTime);
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include "Shapes.h"
+#include <vector>
+
+// Types shared by the collision broadphases used by the ObjectManager.
+// A broadphase takes the bounding boxes of all colliders in the current
+// scene and produces a shorter list of pairs that might be colliding.
+// Only these pairs are then tested with IShape2D::Intersects.
+
+// The method the ObjectManager uses to find pairs of objects that might be colliding
+// BRUTEFORCE tests every collider against every other collider. It is slow, but is
+// kept so that the results of the other methods can be checked against it.
+// SPATIALHASH suits scenes where objects are roughly the same size.
+// SWEEPANDPRUNE suits scenes where objects move a short distance each frame.
+// AABBTREE suits large scenes with objects of very different sizes.
+enum class BroadphaseType { BRUTEFORCE, SPATIALHASH, SWEEPANDPRUNE, AABBTREE };
+
+// A pair of colliders that might be colliding.
+// The values are indices into the list of colliders passed to the broadphase
+// and first is always less than second.
+struct CollisionPair
+{
+	int first;
+	int second;
+
+	bool operator<(const CollisionPair& other) const
+	{
+		return first < other.first || (first == other.first && second < other.second);
+	}
+};
+
+// The collision filters of the colliders passed to a broadphase.
+// A broadphase given a filter does not report pairs that it does not allow,
+// so they are never stored.
+struct CollisionFilter
+{
+	const std::vector<unsigned int>* pCategories;	// Collision category of each collider
+	const std::vector<unsigned int>* pMasks;		// Collision mask of each collider
+
+	// Returns true if colliders "first" and "second" are allowed to collide.
+	// Each must be in a category that the other's mask accepts.
+	bool Allows(int first, int second) const
+	{
+		return ((*pCategories)[first] & (*pMasks)[second]) && ((*pCategories)[second] & (*pMasks)[first]);
+	}
+};
+
+// Returns true if the two boxes overlap. Unlike Rectangle2D::Intersects, this
+// includes boxes that only touch, since the shapes inside might still intersect.
+inline bool BoxesOverlap(const Rectangle2D& a, const Rectangle2D& b)
+{
+	return a.GetBottomLeft().XValue <= b.GetTopRight().XValue
+		&& b.GetBottomLeft().XValue <= a.GetTopRight().XValue
+		&& a.GetBottomLeft().YValue <= b.GetTopRight().YValue
+		&& b.GetBottomLeft().YValue <= a.GetTopRight().YValue;
+}
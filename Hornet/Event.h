@@ -1,5 +1,6 @@
 #pragma once
 #include "vector2D.h"
+#include "ObjectHandle.h"
 enum EventType { NONE, EXPLOSION, OBJECTCREATED, OBJECTDESTROYED, MISSIONCOMPLETE };
 
 class GameObject;
@@ -11,5 +12,6 @@ struct Event
 	Vector2D position;
 	double data1;
 	double data2;
+	ObjectHandle source;	// Handle of pSource. Use ObjectManager::Resolve, in case the source has been deleted
 };
 
@@ -23,7 +23,7 @@ void Game::StartOfGame()
     Rock* pRock;
     for (int i = 0; i < 10; i++)
     {
-        pRock = new Rock;
+        pRock = ObjectManager::instance.Create<Rock>();
         pRock->Initialise();
         ObjectManager::instance.AddItem(pRock);
     }
@@ -31,7 +31,7 @@ void Game::StartOfGame()
     Spaceship* pSpaceship;
     for (int i = 0; i < 1; i++)
     {
-        pSpaceship = new Spaceship;
+        pSpaceship = ObjectManager::instance.Create<Spaceship>();
         pSpaceship->Initialise();
         ObjectManager::instance.AddItem(pSpaceship);
     }
@@ -1,6 +1,7 @@
 #include "GameObject.h"
 #include "HtGraphics.h"
 #include "ErrorLogger.h"
+#include "ObjectManager.h"
 
 const int DEBUGLINESEPARATION = 40;
 const double DEBUGTEXTSCALE = 1.0;
@@ -57,10 +58,17 @@ GameObject::GameObject(ObjectType type) : TYPE(type)
 	m_drawDepth = 0;
 	m_sceneNumber = 0;
 	m_collidable = false;
+	m_threadSafeUpdate = false;
+	m_continuousCollision = false;
+	m_collisionCategory = 1;
+	m_collisionMask = ALLCOLLISIONCATEGORIES;
 	m_handleEvents = false;
 	m_debugLineNumber = 0;
 	m_locked = false;
 	m_transparency = 0;
+	m_spatialProxy = -1;
+	m_partitionScene = 0;
+	m_pPool = nullptr;
 }
 
 GameObject::GameObject(): GameObject(ObjectType::UNKNOWN)
@@ -73,6 +81,11 @@ Vector2D GameObject::GetPosition() const
 	return m_position;
 }
 
+ObjectHandle GameObject::GetHandle() const
+{
+	return m_handle;
+}
+
 void GameObject::SetDrawDepth(int depth)
 {
 	if (!m_locked)
@@ -93,6 +106,64 @@ void GameObject::SetCollidable()
 #endif // DEBUG
 }
 
+void GameObject::SetThreadSafeUpdate()
+{
+	if (!m_locked)
+		m_threadSafeUpdate = true;
+#ifdef _DEBUG
+	else
+		ErrorLogger::Write("You have called SetThreadSafeUpdate() on an object after it has been locked.");
+#endif // DEBUG
+}
+
+bool GameObject::IsThreadSafeUpdate() const
+{
+	return m_threadSafeUpdate;
+}
+
+void GameObject::SetCollisionFilter(unsigned int category, unsigned int mask)
+{
+	if (!m_locked)
+	{
+		m_collisionCategory = category;
+		m_collisionMask = mask;
+	}
+#ifdef _DEBUG
+	else
+		ErrorLogger::Write("You have called SetCollisionFilter() on an object after it has been locked.");
+#endif // DEBUG
+}
+
+unsigned int GameObject::GetCollisionCategory() const
+{
+	return m_collisionCategory;
+}
+
+unsigned int GameObject::GetCollisionMask() const
+{
+	return m_collisionMask;
+}
+
+void GameObject::SetContinuousCollision()
+{
+	if (!m_locked)
+		m_continuousCollision = true;
+#ifdef _DEBUG
+	else
+		ErrorLogger::Write("You have called SetContinuousCollision() on an object after it has been locked.");
+#endif // DEBUG
+}
+
+bool GameObject::UsesContinuousCollision() const
+{
+	return m_continuousCollision;
+}
+
+void GameObject::ResetMovement()
+{
+	m_previousPosition = m_position;
+}
+
 void GameObject::SetHandleEvents()
 {
 	if (!m_locked)
@@ -191,8 +262,10 @@ ObjectType GameObject::GetType() const
 
 void GameObject::Deactivate()
 {
+	// Once in the ObjectManager, it needs to know to delete the object
+	if (m_active && m_locked)
+		ObjectManager::instance.QueueRemoval(this);
 	m_active = false;
-
 }
 
 bool GameObject::IsCollidable()
@@ -224,7 +297,7 @@ void GameObject::Initialise(const char* imagefile, Vector2D position, double ang
 	LoadImage(imagefile);
 	m_scale = scale;
 	m_position = position;
-	m_sceneNumber = 0;
+	SetSceneNumber(0);
 
 
 }
@@ -248,6 +321,21 @@ void GameObject::ProcessCollision(GameObject& other)
 	// Default behaviour is to do nothing.
 }
 
+void GameObject::OnCollisionEnter(GameObject& other)
+{
+	// Default behaviour is to do nothing.
+}
+
+void GameObject::OnCollisionStay(GameObject& other)
+{
+	// Default behaviour is to do nothing.
+}
+
+void GameObject::OnCollisionExit(GameObject& other)
+{
+	// Default behaviour is to do nothing.
+}
+
 void GameObject::Update(double frametime)
 {
 	// Default is to not move, but set the height and width of the default rectangle
@@ -280,20 +368,20 @@ void GameObject::RenderDebugShape()
 
 		HtGraphics::instance.FillCircle(dot, DEBUGBROWN);
 	}
-	else if (typeid(shape) == typeid(Rectangle2D))
+	else if (shape.GetKind() == ShapeKind::RECTANGLE)
 	{
 		HtGraphics::instance.FillRect(*reinterpret_cast<Rectangle2D*>( & shape), DEBUGGREEN);
 	}
-	else if (typeid(shape) == typeid(Circle2D))
+	else if (shape.GetKind() == ShapeKind::CIRCLE)
 	{
 		HtGraphics::instance.FillCircle(*reinterpret_cast<Circle2D*>(&shape), DEBUGGREEN);
 	}
-	else if (typeid(shape) == typeid(Segment2D))
+	else if (shape.GetKind() == ShapeKind::SEGMENT)
 	{
 		HtGraphics::instance.DrawSegment(*reinterpret_cast<Segment2D*>(&shape), DEBUGGREEN);
 	}
 
-	else if (typeid(shape) == typeid(AngledRectangle2D))
+	else if (shape.GetKind() == ShapeKind::ANGLEDRECTANGLE)
 	{
 		HtGraphics::instance.FillAngledRect(*reinterpret_cast<AngledRectangle2D*>(&shape), DEBUGGREEN);
 	}
@@ -318,7 +406,12 @@ int GameObject::GetSceneNumber() const
 // Sets the scene number of the object. Only objects in the current scene will be drawn or updated.
 void GameObject::SetSceneNumber(int sceneNumber)
 {
+	bool changed = (sceneNumber != m_sceneNumber);
 	m_sceneNumber = sceneNumber;
+
+	// Once in the ObjectManager, it needs to move to the new scene's objects
+	if (m_locked && changed)
+		ObjectManager::instance.QueueSceneChange(this);
 }
 
 
@@ -5,8 +5,14 @@
 #include "Shapes.h"
 #include "HtGraphics.h"
 #include "event.h" 
+#include "ObjectHandle.h"
 #include <vector>
 
+class ObjectPool;
+
+// Collision filter that includes every category. See GameObject::SetCollisionFilter.
+const unsigned int ALLCOLLISIONCATEGORIES = 0xFFFFFFFF;
+
 // Base class for all game objects
 class GameObject
 {
@@ -19,8 +25,20 @@ private:
 								// "background".) Cannot change after the GameObject is locked.
 	bool m_handleEvents;		// Whether or not to process events. Default is false. Cannot change after the GameObject is locked.
 	bool m_collidable;			// Whether or not the object should collide. Default is false. Cannot change after the GameObject is locked.
+	bool m_threadSafeUpdate;	// Whether Update() may run on a worker thread. Default is false. Cannot change after the GameObject is locked.
+	bool m_continuousCollision;	// Whether collisions are tested along the object's movement. Default is false. Cannot change after the GameObject is locked.
+	Vector2D m_previousPosition;	// Position before the last update, for continuous collision detection
+	unsigned int m_collisionCategory;	// Bits for the categories the object belongs to. Default is 1. Cannot change after the GameObject is locked.
+	unsigned int m_collisionMask;	// Bits for the categories the object can collide with. Default is all. Cannot change after the GameObject is locked.
 	int m_debugLineNumber;		// Used to draw the debug information on the next line.
 	Rectangle2D m_defaultCollisionShape;
+	int m_spatialProxy;			// The object's proxy in the ObjectManager's spatial index. -1 if not indexed.
+	int m_partitionScene;		// The scene whose ObjectManager partition holds this object. May briefly differ from m_sceneNumber.
+	ObjectPool* m_pPool;		// The pool the object was created in by ObjectManager::Create. nullptr if created with new.
+	ObjectHandle m_handle;		// Set when added to the ObjectManager
+
+	// Maintains m_spatialProxy, m_partitionScene, m_pPool, m_handle and m_previousPosition
+	friend class ObjectManager;
 protected:
 	std::vector<PictureIndex> m_images;		// Indices of the pictures loaded using LoadPicture. If a picture is not loaded, this will be 0
 	Vector2D m_position;		// Position of the object
@@ -59,6 +77,10 @@ public:
 	// Returns the position of the object
 	Vector2D GetPosition() const;
 
+	// Returns a handle that can be stored to refer to this object later.
+	// Null until the object has been added to the ObjectManager.
+	ObjectHandle GetHandle() const;
+
 	// Load an image and stores the index in m_image. 
 	// If the filename is invalid, m_image will be set to 0
 	void LoadImage(const char* filename);
@@ -76,6 +98,20 @@ public:
 	// Default behaviour is to do nothing
 	virtual void ProcessCollision(GameObject& other);
 
+	// Called after ProcessCollision when this object starts colliding with the other.
+	// Default behaviour is to do nothing
+	virtual void OnCollisionEnter(GameObject& other);
+
+	// Called after ProcessCollision on each later frame that the two are still colliding.
+	// Default behaviour is to do nothing
+	virtual void OnCollisionStay(GameObject& other);
+
+	// Called on the first frame that the two are no longer colliding, such as when one has
+	// left the scene. Not called if either has been deleted since, which happens to
+	// deactivated objects in ObjectManager::DeleteInactiveItems.
+	// Default behaviour is to do nothing
+	virtual void OnCollisionExit(GameObject& other);
+
 	// Used to process each frame
 	// Default behaviour is to do nothing, but it
 	// will set the position of the default collision rectangle if collision
@@ -132,6 +168,49 @@ public:
 	// Sets the object to handle events. This will have no effect after the Object is Lock()ed.
 	void SetHandleEvents();
 
+	// Declares that this object's Update() only uses the object itself, so the ObjectManager
+	// may run it on a worker thread while other objects are being updated.
+	// Such an Update() may change the object's own state, Deactivate() it and call AddItem (new
+	// objects are added once all updates have finished). New objects may be made with "new"
+	// or ObjectManager::Create. It must not read or change other objects,
+	// search for objects, change scene or use graphics, sound or input.
+	// These objects are updated before the other objects in the scene.
+	// This will have no effect after the Object is Lock()ed.
+	void SetThreadSafeUpdate();
+
+	// Returns true if Update() may run on a worker thread
+	bool IsThreadSafeUpdate() const;
+
+	// Sets which objects this object can collide with. Each bit of "category" is a category the
+	// object belongs to, and each bit of "mask" is a category it can collide with.
+	// Two objects only collide if each is in a category that the other's mask includes,
+	// so pairs that should never collide, such as two rocks, are not tested at all.
+	// The defaults are category 1 and a mask of ALLCOLLISIONCATEGORIES.
+	// This will have no effect after the Object is Lock()ed.
+	void SetCollisionFilter(unsigned int category, unsigned int mask);
+
+	// Returns the categories the object belongs to
+	unsigned int GetCollisionCategory() const;
+
+	// Returns the categories the object can collide with
+	unsigned int GetCollisionMask() const;
+
+	// Tests this object's collisions along the whole of its movement each frame, rather
+	// than just where it ends up, so a fast object cannot pass through another.
+	// Only works if the collision shape is a Circle2D or a Point2D. Other shapes are
+	// tested where they end up, as usual.
+	// Use ObjectManager::GetCollisionTime() in ProcessCollision to find when the collision happened.
+	// This will have no effect after the Object is Lock()ed.
+	void SetContinuousCollision();
+
+	// Returns true if collisions are tested along the object's movement
+	bool UsesContinuousCollision() const;
+
+	// Call after moving the object without travelling between the two places, such as
+	// wrapping round the edge of the screen, so that continuous collision detection
+	// does not test everything in between.
+	void ResetMovement();
+
 	// After this is called, no changes can be made to collidable, draw depth or handle events
 	void Lock();
 };
@@ -4,6 +4,7 @@
 #include "HornetApp.h"
 #include "HtCamera.h"
 #include "sdl.h"
+#include <cmath>
 
 
 
@@ -62,18 +63,38 @@ PictureIndex HtGraphics::LoadPicture(const std::string filename)
     SDL_SetColorKey(pImageSurface, SDL_TRUE, SDL_MapRGB(pImageSurface->format, 
         m_transparentColour.r, m_transparentColour.g, m_transparentColour.b));
 
-    //Create texture from surface pixels
     Texture texture;
-    texture.pTexture= SDL_CreateTextureFromSurface(m_pRenderer, pImageSurface);
-    if (texture.pTexture == nullptr)
-    {
-        ErrorLogger::Write("Could not create texture image in HtGraphics::AddPicture():"+filename);
-        ErrorLogger::Write(SDL_GetError());
-        return NO_PICTURE_INDEX;
-    }
     texture.width = pImageSurface->w;
     texture.height = pImageSurface->h;
 
+    // Pack the picture into the atlas if possible, so that sprites using different
+    // pictures can be drawn together. Large pictures get their own texture.
+    if (m_atlas.Add(pImageSurface, texture.pTexture, texture.sourceArea))
+    {
+        float pageSize = float(m_atlas.GetPageSize());
+        texture.uvArea.x = texture.sourceArea.x / pageSize;
+        texture.uvArea.y = texture.sourceArea.y / pageSize;
+        texture.uvArea.w = texture.sourceArea.w / pageSize;
+        texture.uvArea.h = texture.sourceArea.h / pageSize;
+        texture.inAtlas = true;
+    }
+    else
+    {
+        //Create texture from surface pixels
+        texture.pTexture = SDL_CreateTextureFromSurface(m_pRenderer, pImageSurface);
+        if (texture.pTexture == nullptr)
+        {
+            ErrorLogger::Write("Could not create texture image in HtGraphics::AddPicture():" + filename);
+            ErrorLogger::Write(SDL_GetError());
+            SDL_FreeSurface(pImageSurface);
+            return NO_PICTURE_INDEX;
+        }
+        UseWholeTexture(texture);
+
+        // Set once here, rather than on every draw
+        SDL_SetTextureBlendMode(texture.pTexture, SDL_BLENDMODE_BLEND);
+    }
+
     //Get rid of old loaded surface
     SDL_FreeSurface(pImageSurface);
 
@@ -121,6 +142,8 @@ PictureIndex HtGraphics::CreatePictureFromText(const std::string text, FontIndex
 
     if (texture.pTexture)
     {
+        SDL_SetTextureBlendMode(texture.pTexture, SDL_BLENDMODE_BLEND);
+
         // Add the texture to the map
         m_pictureMap.insert(std::pair<PictureIndex, Texture>(m_nextPictureIndex, texture));
         PictureIndex oldIndex = m_nextPictureIndex;
@@ -152,40 +175,12 @@ Result HtGraphics::DrawAt(Vector2D centre, PictureIndex picture, double scale, d
     centre = HtCamera::instance.NativeTransform(centre);
     scale = HtCamera::instance.NativeTransform(scale);
 
-    //Render texture to screen
-    SDL_Rect targetArea;
-    targetArea.h = int(picit->second.height*scale);
-    targetArea.w = int(picit->second.width*scale);
-    targetArea.x = int(centre.XValue-targetArea.w /2);
-    targetArea.y = int(centre.YValue-targetArea.h / 2);
-
-    // Render. Parameters are: the renderer, the texture, the area of the texture (NULL for all),
-    // the area of the target (calculated above), the rotation angle in degrees, the centre of rotation
-    // (NULL for image centre) and FLIP flags.
-
-    // Do I need to do this every time? Or just do it when I set up the engine?
-    SDL_SetTextureBlendMode(picit->second.pTexture, SDL_BLENDMODE_BLEND);
-
+    // Blend mode is set when the texture is created, and transparency goes in the
+    // vertex colours, so there is no need to change the texture's settings here.
+    QueueSprite(picit->second.pTexture, picit->second.uvArea, float(centre.XValue), float(centre.YValue),
+        float(picit->second.width * scale), float(picit->second.height * scale),
+        angle, SDL_Color{ 255, 255, 255, Uint8(255 * (1.0 - transparency)) });
 
-    SDL_SetTextureAlphaMod(picit->second.pTexture, Uint8(255 * (1.0 - transparency)));
-
-    if (SDL_RenderCopyEx(m_pRenderer, picit->second.pTexture, NULL, &targetArea, angle, NULL, SDL_FLIP_NONE) < 0)
-    {
-        ErrorLogger::Write("Could not render image in HtGraphics::DrawAt().");
-
-#ifdef _DEBUG
-        for (std::pair<const std::string, PictureIndex>& p : m_filenameMap)
-        {
-            if (p.second == picture)
-            {
-                ErrorLogger::Write("Image: " + p.first);
-            }
-        }
-#endif // DEBUG
-
-        ErrorLogger::Write(SDL_GetError());
-        return Result::FAILURE;
-    }
     return Result::SUCCESS;
 }
 
@@ -193,19 +188,11 @@ Result HtGraphics::FillRect(Rectangle2D rect, Colour colour)
 {
     rect = HtCamera::instance.NativeTransform(rect);
 
-    SDL_Rect fillRect;
-    fillRect.x = int(rect.GetBottomLeft().XValue);
-    fillRect.y = int(rect.GetBottomLeft().YValue);
-    fillRect.w = int(rect.GetTopRight().XValue - rect.GetBottomLeft().XValue);
-    fillRect.h = int(rect.GetTopRight().YValue - rect.GetBottomLeft().YValue);
-
-    SDL_SetRenderDrawColor(m_pRenderer, colour.r, colour.g, colour.b, colour.a );
-    if (SDL_RenderFillRect(m_pRenderer, &fillRect) < 0)
-    {
-        ErrorLogger::Write("Could not fill rectangle in HtGraphics::FillRect().");
-        ErrorLogger::Write(SDL_GetError());
-        return Result::FAILURE;
-    }
+    RenderCommand& command = m_renderQueue.Add(RenderCommandType::FILLRECT, nullptr, SDL_BLENDMODE_BLEND, colour.ToSDLColor());
+    command.position.x = float(rect.GetBottomLeft().XValue);
+    command.position.y = float(rect.GetBottomLeft().YValue);
+    command.size.x = float(rect.GetTopRight().XValue - rect.GetBottomLeft().XValue);
+    command.size.y = float(rect.GetTopRight().YValue - rect.GetBottomLeft().YValue);
 
     return Result::SUCCESS;
 }
@@ -217,38 +204,23 @@ Result HtGraphics::FillAngledRect(AngledRectangle2D rect, Colour colour)
     Vector2D corner1off(-rect.GetWidth() / 2, rect.GetHeight() / 2);
     Vector2D corner2off(rect.GetWidth() / 2, rect.GetHeight() / 2);
 
-    Vector2D corner1 = rect.GetCentre() + corner1off.rotatedBy(rect.GetAngle());
-    Vector2D corner2 = rect.GetCentre() + corner2off.rotatedBy(rect.GetAngle());
-    Vector2D corner3 = rect.GetCentre() + corner1off.rotatedBy(rect.GetAngle()+180);
-    Vector2D corner4 = rect.GetCentre() + corner2off.rotatedBy(rect.GetAngle()+180);
-    SDL_Color col = colour.ToSDLColor();
-
-    SDL_Vertex vertex_1 = { {(float)corner1.XValue, (float)corner1.YValue}, col, {1, 1} };
-    SDL_Vertex vertex_2 = { {(float)corner2.XValue, (float)corner2.YValue}, col, {1, 1} };
-    SDL_Vertex vertex_3 = { {(float)corner3.XValue, (float)corner3.YValue}, col, {1, 1} };
-    SDL_Vertex vertex_4 = { {(float)corner4.XValue, (float)corner4.YValue}, col, {1, 1} };
-
-    SDL_Vertex vertices[] = {
-    vertex_1,
-    vertex_2,
-    vertex_3,
-    vertex_1,
-    vertex_3,
-    vertex_4,
-    };
+    Vector2D corners[4];
+    corners[0] = rect.GetCentre() + corner1off.rotatedBy(rect.GetAngle());
+    corners[1] = rect.GetCentre() + corner2off.rotatedBy(rect.GetAngle());
+    corners[2] = rect.GetCentre() + corner1off.rotatedBy(rect.GetAngle()+180);
+    corners[3] = rect.GetCentre() + corner2off.rotatedBy(rect.GetAngle()+180);
 
-
-    SDL_SetRenderDrawColor(m_pRenderer, colour.r, colour.g, colour.b, colour.a);
-  //  SDL_RenderClear(m_pRenderer);
-
-
-    if (SDL_RenderGeometry(m_pRenderer, nullptr, vertices, 6, NULL, 0) < 0)
+    int first = m_renderQueue.AddPoints(4);
+    SDL_FPoint* pPoints = m_renderQueue.GetPoints() + first;
+    for (int i = 0; i < 4; ++i)
     {
-        ErrorLogger::Write("Could not fill rectangle in HtGraphics::FillAngledRect().");
-        ErrorLogger::Write(SDL_GetError());
-        return Result::FAILURE;
+        pPoints[i].x = (float)corners[i].XValue;
+        pPoints[i].y = (float)corners[i].YValue;
     }
-    SDL_RenderPresent(m_pRenderer);
+
+    RenderCommand& command = m_renderQueue.Add(RenderCommandType::FILLANGLEDRECT, nullptr, SDL_BLENDMODE_BLEND, colour.ToSDLColor());
+    command.firstPoint = first;
+    command.numPoints = 4;
     return Result::SUCCESS;
 }
 
@@ -261,61 +233,12 @@ Result HtGraphics::FillCircle(Vector2D centre, double radius, Colour colour)
 {
     centre = HtCamera::instance.NativeTransform(centre);
     radius = HtCamera::instance.NativeTransform(radius);
-    SDL_SetRenderDrawColor(m_pRenderer, colour.r, colour.g, colour.b, colour.a);
-
-    int x = int(centre.XValue);
-    int y = int(centre.YValue);
-    int r = int(radius);
-   
-    int offsetx = 0;
-    int offsety = r;
-    int d = r - 1;
-    int error = 0;
-
-    while (offsety >= offsetx)
-    {
-        error += SDL_RenderDrawLine(m_pRenderer, x - offsety, y + offsetx,
-            x + offsety, y + offsetx);
-        error += SDL_RenderDrawLine(m_pRenderer, x - offsetx, y + offsety,
-            x + offsetx, y + offsety);
-        error += SDL_RenderDrawLine(m_pRenderer, x - offsetx, y - offsety,
-            x + offsetx, y - offsety);
-        error += SDL_RenderDrawLine(m_pRenderer, x - offsety, y - offsetx,
-            x + offsety, y - offsetx);
-
-        if (error < 0)
-        {
-            break;
-        }
-
-        if (d >= 2 * offsetx)
-        {
-            d -= 2 * offsetx + 1;
-            offsetx += 1;
-        }
-        else if (d < 2 * (r - offsety))
-        {
-            d += 2 * offsety - 1;
-            offsety -= 1;
-        }
-        else
-        {
-            d += 2 * (offsety - offsetx - 1);
-            offsety -= 1;
-            offsetx += 1;
-        }
-    }
 
-    if (error < 0)
-    {
-        ErrorLogger::Write("Could not fill circle in HtGraphics::FillCircle().");
-        ErrorLogger::Write(SDL_GetError());
-        return Result::FAILURE;
-    }
-    else
-    {
-        return Result::SUCCESS;
-    }
+    RenderCommand& command = m_renderQueue.Add(RenderCommandType::FILLCIRCLE, nullptr, SDL_BLENDMODE_BLEND, colour.ToSDLColor());
+    command.position.x = float(centre.XValue);
+    command.position.y = float(centre.YValue);
+    command.size.x = float(radius);
+    return Result::SUCCESS;
 }
 
 Result HtGraphics::DrawSegment(Segment2D segment, Colour colour)
@@ -327,63 +250,42 @@ Result HtGraphics::DrawSegment(Vector2D start, Vector2D end, Colour colour)
 {
     start=HtCamera::instance.NativeTransform(start);
     end = HtCamera::instance.NativeTransform(end);
-    SDL_SetRenderDrawColor(m_pRenderer, colour.r, colour.g, colour.b, colour.a);
 
-    if (SDL_RenderDrawLine(m_pRenderer,
-        int(start.XValue), int(start.YValue), int(end.XValue), int(end.YValue)) < 0)
-    {
-        ErrorLogger::Write("Could not draw line in HtGraphics::DrawSegment().");
-        ErrorLogger::Write(SDL_GetError());
-        return Result::FAILURE;
-    }
-    else
-    {
-        return Result::SUCCESS;
-    }
+    RenderCommand& command = m_renderQueue.Add(RenderCommandType::SEGMENT, nullptr, SDL_BLENDMODE_BLEND, colour.ToSDLColor());
+    command.position.x = float(start.XValue);
+    command.position.y = float(start.YValue);
+    command.size.x = float(end.XValue - start.XValue);
+    command.size.y = float(end.YValue - start.YValue);
+    return Result::SUCCESS;
 }
 
 Result HtGraphics::DrawPoint(Vector2D point, Colour colour)
 {
-    point = HtCamera::instance.NativeTransform(point);
-    SDL_SetRenderDrawColor(m_pRenderer, colour.r, colour.g, colour.b, colour.a);
-    if (SDL_RenderDrawPoint(m_pRenderer, int(point.XValue), int(point.YValue)) < 0)
-    {
-        ErrorLogger::Write("Could not draw point in HtGraphics::DrawPoint().");
-        ErrorLogger::Write(SDL_GetError());
-        return Result::FAILURE;
-
-    }
-    return Result::SUCCESS;
+    return DrawPointList(&point, colour, 1);
 }
 
 Result HtGraphics::DrawPointList(const Vector2D points[], Colour colour, const int numPoints)
 {
-    // Hmm. Would be nice to do this in hardware
-    SDL_Point* pList = nullptr;
-    pList = new SDL_Point[numPoints];
-    if (!pList)
+    if (numPoints <= 0)
     {
         ErrorLogger::Write("Could not draw points in HtGraphics::DrawPointList().");
         ErrorLogger::Write("numPoints invalid?");
         return Result::FAILURE;
     }
+
+    // Points are rounded down to whole pixels, as SDL_RenderDrawPoints() would do
+    int first = m_renderQueue.AddPoints(numPoints);
+    SDL_FPoint* pPoints = m_renderQueue.GetPoints() + first;
     for (int i = 0; i < numPoints; ++i)
     {
         Vector2D point = HtCamera::instance.NativeTransform(points[i]);
-        pList[i].x = int(point.XValue);
-        pList[i].y = int(point.YValue);
+        pPoints[i].x = float(int(point.XValue));
+        pPoints[i].y = float(int(point.YValue));
     }
 
-    SDL_SetRenderDrawColor(m_pRenderer, colour.r, colour.g, colour.b, colour.a);
-    if (SDL_RenderDrawPoints(m_pRenderer, pList, numPoints) < 0)
-    {
-        ErrorLogger::Write("Could not draw points in HtGraphics::DrawPointList().");
-        ErrorLogger::Write(SDL_GetError());
-        delete[] pList;
-        return Result::FAILURE;
-
-    }
-    delete[] pList;
+    RenderCommand& command = m_renderQueue.Add(RenderCommandType::POINTS, nullptr, SDL_BLENDMODE_BLEND, colour.ToSDLColor());
+    command.firstPoint = first;
+    command.numPoints = numPoints;
     return Result::SUCCESS;
 }
 
@@ -392,35 +294,7 @@ Result HtGraphics::WriteTextCentered(Vector2D centre, std::string text, Colour c
     centre = HtCamera::instance.NativeTransform(centre);
     scale = HtCamera::instance.NativeTransform(scale);
 
-    if (text.size() > 0)
-    {
-        Texture texture = CreateTextureFromText(text, font, colour);
-        if (texture.pTexture)
-        {
-            SDL_Rect targetArea;
-            targetArea.x = int(centre.XValue - texture.width * scale/2);
-            targetArea.y = int(centre.YValue- texture.height * scale/2);
-            targetArea.h = int(texture.height * scale);
-            targetArea.w = int(texture.width * scale);
-
-            SDL_SetTextureBlendMode(texture.pTexture, SDL_BLENDMODE_BLEND);
-
-            if (SDL_RenderCopyEx(m_pRenderer, texture.pTexture, NULL, &targetArea, angle, NULL, SDL_FLIP_NONE) < 0)
-            {
-                ErrorLogger::Write("Could not render text in HtGraphics::WriteTextScreen().");
-                ErrorLogger::Write(SDL_GetError());
-                return Result::FAILURE;
-            }
-
-            SDL_DestroyTexture(texture.pTexture);
-        }
-        else
-        {
-            ErrorLogger::Write("Failed to create texture for text in HtGraphics::WriteTextScreen().");
-            return Result::FAILURE;
-        }
-    }
-    return Result::SUCCESS;
+    return WriteGlyphs(centre, true, text, colour, font, angle, scale);
 }
 
 Result HtGraphics::WriteTextAligned(Vector2D topLeft, std::string text, Colour colour, FontIndex font, double scale)
@@ -428,35 +302,7 @@ Result HtGraphics::WriteTextAligned(Vector2D topLeft, std::string text, Colour c
     topLeft = HtCamera::instance.NativeTransform(topLeft);
     scale = HtCamera::instance.NativeTransform(scale);
 
-    if (text.size() > 0)
-    {
-        Texture texture = CreateTextureFromText(text, font, colour);
-        if (texture.pTexture)
-        {
-            SDL_Rect targetArea;
-            targetArea.x = int(topLeft.XValue);
-            targetArea.y = int(topLeft.YValue);
-            targetArea.h = int(texture.height * scale);
-            targetArea.w = int(texture.width * scale);
-
-            SDL_SetTextureBlendMode(texture.pTexture, SDL_BLENDMODE_BLEND);
-
-            if (SDL_RenderCopy(m_pRenderer, texture.pTexture, NULL, &targetArea) < 0)
-            {
-                ErrorLogger::Write("Could not render text in HtGraphics::WriteTextScreen().");
-                ErrorLogger::Write(SDL_GetError());
-                return Result::FAILURE;
-            }
-
-            SDL_DestroyTexture(texture.pTexture);
-        }
-        else
-        {
-            ErrorLogger::Write("Failed to create texture for text in HtGraphics::WriteTextScreen().");
-            return Result::FAILURE;
-        }
-    }
-    return Result::SUCCESS;
+    return WriteGlyphs(topLeft, false, text, colour, font, 0, scale);
 }
 
 Result HtGraphics::WriteTextAligned(int topLeftX, int topLeftY, std::string text, Colour colour, FontIndex font, double scale)
@@ -496,6 +342,11 @@ Result HtGraphics::WriteFloatAligned(int topLeftX, int topLeftY, double number,
 
 Result HtGraphics::Present()
 {
+    // Draw everything queued this frame, sorted to reduce changes of renderer state
+    m_renderQueue.Sort();
+    Result result = DrawQueue();
+    m_renderQueue.Clear();
+
     //Update screen
     SDL_RenderPresent(m_pRenderer);
 
@@ -520,7 +371,7 @@ Result HtGraphics::Present()
         }
 
         // Switch off colour key for transparency?
-        if (SDL_RenderCopy(m_pRenderer, picit->second.pTexture,nullptr, nullptr) < 0)
+        if (SDL_RenderCopy(m_pRenderer, picit->second.pTexture, &picit->second.sourceArea, nullptr) < 0)
         {
             ErrorLogger::Write("Could not render background texture in HtGraphics::Present().");
             ErrorLogger::Write(SDL_GetError());
@@ -528,7 +379,7 @@ Result HtGraphics::Present()
         }
     }
 
-    return Result::SUCCESS;
+    return result;
 }
 
 Result HtGraphics::Initialise()
@@ -567,6 +418,10 @@ Result HtGraphics::Initialise()
 
     SDL_SetRenderDrawBlendMode(m_pRenderer, SDL_BLENDMODE_BLEND);
 
+    // Pictures and the glyphs of fonts will be packed into textures made by this renderer
+    m_atlas.Initialise(m_pRenderer);
+    m_glyphAtlas.Initialise(m_pRenderer);
+
     // Set up image loading for PNG, JPG, TIF and WEBP
     int result = IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG);
     if ((result & IMG_INIT_JPG) == 0)
@@ -630,8 +485,12 @@ void HtGraphics::ReleasePicture(PictureIndex picture)
     // If the picture is actually loaded
     if (picit != m_pictureMap.end())
     {
-        if (picit->second.pTexture)
+        // Pictures in the atlas share their texture with other pictures, so leave it alone
+        if (picit->second.pTexture && !picit->second.inAtlas)
         {
+            // Commands queued this frame may use this texture
+            m_renderQueue.RemoveTexture(picit->second.pTexture);
+
             // Release the texture
             SDL_DestroyTexture(picit->second.pTexture);
         }
@@ -666,13 +525,23 @@ void HtGraphics::ReleaseAllPictures()
     // Loop through all textures
     for (; picit != m_pictureMap.end(); picit++)
     {
-        if (picit->second.pTexture)
+        if (picit->second.pTexture && !picit->second.inAtlas)
         {
+            // Commands queued this frame may use this texture
+            m_renderQueue.RemoveTexture(picit->second.pTexture);
+
             // Release the texture
             SDL_DestroyTexture(picit->second.pTexture);
         }
     }
 
+    // Release the atlas pages
+    for (int i = 0; i < m_atlas.GetNumPages(); ++i)
+    {
+        m_renderQueue.RemoveTexture(m_atlas.GetPage(i));
+    }
+    m_atlas.Clear();
+
     // Empty the two lists
     m_pictureMap.clear();
     m_filenameMap.clear();
@@ -694,6 +563,14 @@ void HtGraphics::ReleaseAllFonts()
         }
     }
 
+    // Commands queued this frame may use the glyph pages
+    for (int i = 0; i < m_glyphAtlas.GetNumPages(); ++i)
+    {
+        m_renderQueue.RemoveTexture(m_glyphAtlas.GetPage(i));
+    }
+    m_glyphMap.clear();
+    m_glyphAtlas.Clear();
+
     // Empty the two lists
     m_fontList.clear();
     m_nextFontIndex = 0;
@@ -749,7 +626,10 @@ Texture HtGraphics::CreateTextureFromText(const std::string text, FontIndex font
     {
         ErrorLogger::Write("Cannot create render surface in HtGraphics::CreateTextureFromText().");
         ErrorLogger::Write(SDL_GetError());
-
+    }
+    else
+    {
+        UseWholeTexture(answer);
     }
 
     // Free the surface
@@ -787,6 +667,363 @@ HtGraphics::~HtGraphics()
     Shutdown();
 }
 
+void HtGraphics::BuildGlyphs(FontIndex fontIndex, TTF_Font* pFont)
+{
+    GlyphSet& glyphSet = m_glyphMap[fontIndex];
+    glyphSet.height = TTF_FontHeight(pFont);
+    glyphSet.glyphs.resize(NUMGLYPHS);
+    glyphSet.kerning.resize(NUMGLYPHS * NUMGLYPHS);
+
+    // Rendered in white, so that the vertex colour sets the colour of the text
+    SDL_Color white = { 255, 255, 255, 255 };
+
+    for (int i = 0; i < NUMGLYPHS; ++i)
+    {
+        Uint16 character = Uint16(FIRSTGLYPH + i);
+        Glyph& glyph = glyphSet.glyphs[i];
+        glyph.pPage = nullptr;
+        glyph.width = 0;
+        glyph.height = 0;
+        glyph.offsetX = 0;
+        glyph.advance = 0;
+
+        int minX, maxX, minY, maxY;
+        if (TTF_GlyphMetrics(pFont, character, &minX, &maxX, &minY, &maxY, &glyph.advance) < 0)
+        {
+            continue;
+        }
+
+        // The rendered image starts at the pen position, or further left if the
+        // glyph overhangs to the left
+        if (minX < 0)
+        {
+            glyph.offsetX = minX;
+        }
+
+        SDL_Surface* pSurface = TTF_RenderGlyph_Blended(pFont, character, white);
+        if (pSurface)
+        {
+            SDL_Rect area;
+            if (m_glyphAtlas.Add(pSurface, glyph.pPage, area))
+            {
+                float pageSize = float(m_glyphAtlas.GetPageSize());
+                glyph.uvArea.x = area.x / pageSize;
+                glyph.uvArea.y = area.y / pageSize;
+                glyph.uvArea.w = area.w / pageSize;
+                glyph.uvArea.h = area.h / pageSize;
+                glyph.width = area.w;
+                glyph.height = area.h;
+            }
+            SDL_FreeSurface(pSurface);
+        }
+    }
+
+    // Kerning adjusts the space between particular pairs of letters, such as "AV"
+    for (int first = 0; first < NUMGLYPHS; ++first)
+    {
+        for (int second = 0; second < NUMGLYPHS; ++second)
+        {
+            glyphSet.kerning[first * NUMGLYPHS + second] = TTF_GetFontKerningSizeGlyphs(pFont,
+                Uint16(FIRSTGLYPH + first), Uint16(FIRSTGLYPH + second));
+        }
+    }
+}
+
+Result HtGraphics::WriteGlyphs(Vector2D position, bool centred, const std::string& text, Colour colour, FontIndex font, double angle, double scale)
+{
+    if (text.size() == 0)
+    {
+        return Result::SUCCESS;
+    }
+
+    if (m_glyphMap.size() <= 0)
+    {
+        ErrorLogger::Write("Cannot write text in HtGraphics::WriteGlyphs().");
+        ErrorLogger::Write("No fonts are loaded.");
+        return Result::FAILURE;
+    }
+    std::map<FontIndex, GlyphSet>::iterator glyphit = m_glyphMap.find(font);
+    if (glyphit == m_glyphMap.end())
+    {
+        ErrorLogger::Write("Cannot find font in HtGraphics::WriteGlyphs().");
+        ErrorLogger::Write("No matching font for that index. Default to first font in list.");
+        glyphit = m_glyphMap.begin();
+    }
+    const GlyphSet& glyphSet = glyphit->second;
+
+    // Characters the atlas does not have are shown as '?'
+    m_glyphNumbers.clear();
+    for (char c : text)
+    {
+        int number = (unsigned char)c - FIRSTGLYPH;
+        if (number < 0 || number >= NUMGLYPHS)
+        {
+            number = '?' - FIRSTGLYPH;
+        }
+        m_glyphNumbers.push_back(number);
+    }
+
+    // Width of the whole text, used to find its centre
+    int width = 0;
+    for (int i = 0; i < (int)m_glyphNumbers.size(); ++i)
+    {
+        if (i > 0)
+        {
+            width += glyphSet.kerning[m_glyphNumbers[i - 1] * NUMGLYPHS + m_glyphNumbers[i]];
+        }
+        width += glyphSet.glyphs[m_glyphNumbers[i]].advance;
+    }
+
+    // Each glyph is placed relative to the centre of the text, then rotated about it
+    Vector2D centre = position;
+    if (!centred)
+    {
+        centre = position + Vector2D(width * scale / 2, glyphSet.height * scale / 2);
+    }
+    double radians = Vector2D::DegreesToRadians(angle);
+    double cosine = cos(radians);
+    double sine = sin(radians);
+
+    SDL_Color vertexColour = colour.ToSDLColor();
+    int pen = 0;
+    for (int i = 0; i < (int)m_glyphNumbers.size(); ++i)
+    {
+        if (i > 0)
+        {
+            pen += glyphSet.kerning[m_glyphNumbers[i - 1] * NUMGLYPHS + m_glyphNumbers[i]];
+        }
+        const Glyph& glyph = glyphSet.glyphs[m_glyphNumbers[i]];
+        if (glyph.pPage)
+        {
+            double offsetX = (pen + glyph.offsetX + glyph.width / 2.0 - width / 2.0) * scale;
+            double offsetY = (glyph.height / 2.0 - glyphSet.height / 2.0) * scale;
+
+            QueueSprite(glyph.pPage, glyph.uvArea,
+                float(centre.XValue + offsetX * cosine - offsetY * sine),
+                float(centre.YValue + offsetX * sine + offsetY * cosine),
+                float(glyph.width * scale), float(glyph.height * scale), angle, vertexColour);
+        }
+        pen += glyph.advance;
+    }
+
+    return Result::SUCCESS;
+}
+
+Result HtGraphics::DrawQueue()
+{
+    Result result = Result::SUCCESS;
+
+    // The renderer's draw colour and blend mode are only changed when a shape needs different ones
+    bool stateSet = false;
+    SDL_Color drawColour = { 0, 0, 0, 0 };
+    SDL_BlendMode blendMode = SDL_BLENDMODE_NONE;
+
+    for (const RenderCommand& command : m_renderQueue.GetCommands())
+    {
+        if (command.type == RenderCommandType::SPRITE)
+        {
+            // Each run of sprites using the same texture is drawn with one call
+            if (m_spriteBatch.GetTexture() != command.pTexture)
+            {
+                if (FlushSprites() == Result::FAILURE)
+                {
+                    result = Result::FAILURE;
+                }
+            }
+            m_spriteBatch.AddSprite(command.pTexture, command.uvArea, command.position.x, command.position.y,
+                command.size.x, command.size.y, command.angle, command.colour);
+            continue;
+        }
+
+        if (FlushSprites() == Result::FAILURE)
+        {
+            result = Result::FAILURE;
+        }
+
+        if (!stateSet || command.blendMode != blendMode)
+        {
+            SDL_SetRenderDrawBlendMode(m_pRenderer, command.blendMode);
+            blendMode = command.blendMode;
+        }
+        if (!stateSet || command.colour.r != drawColour.r || command.colour.g != drawColour.g
+            || command.colour.b != drawColour.b || command.colour.a != drawColour.a)
+        {
+            SDL_SetRenderDrawColor(m_pRenderer, command.colour.r, command.colour.g, command.colour.b, command.colour.a);
+            drawColour = command.colour;
+        }
+        stateSet = true;
+
+        if (DrawShape(command) == Result::FAILURE)
+        {
+            result = Result::FAILURE;
+        }
+    }
+
+    if (FlushSprites() == Result::FAILURE)
+    {
+        result = Result::FAILURE;
+    }
+    return result;
+}
+
+Result HtGraphics::DrawShape(const RenderCommand& command)
+{
+    const SDL_FPoint* pPoints = m_renderQueue.GetPoints() + command.firstPoint;
+
+    switch (command.type)
+    {
+    case RenderCommandType::FILLRECT:
+    {
+        SDL_Rect fillRect;
+        fillRect.x = int(command.position.x);
+        fillRect.y = int(command.position.y);
+        fillRect.w = int(command.size.x);
+        fillRect.h = int(command.size.y);
+        if (SDL_RenderFillRect(m_pRenderer, &fillRect) < 0)
+        {
+            ErrorLogger::Write("Could not fill rectangle in HtGraphics::DrawShape().");
+            ErrorLogger::Write(SDL_GetError());
+            return Result::FAILURE;
+        }
+        break;
+    }
+    case RenderCommandType::FILLANGLEDRECT:
+    {
+        SDL_Vertex vertices[6];
+        const int corners[6] = { 0, 1, 2, 0, 2, 3 };
+        for (int i = 0; i < 6; ++i)
+        {
+            vertices[i].position = pPoints[corners[i]];
+            vertices[i].color = command.colour;
+            vertices[i].tex_coord = SDL_FPoint{ 1, 1 };
+        }
+        if (SDL_RenderGeometry(m_pRenderer, nullptr, vertices, 6, NULL, 0) < 0)
+        {
+            ErrorLogger::Write("Could not fill angled rectangle in HtGraphics::DrawShape().");
+            ErrorLogger::Write(SDL_GetError());
+            return Result::FAILURE;
+        }
+        break;
+    }
+    case RenderCommandType::FILLCIRCLE:
+    {
+        int x = int(command.position.x);
+        int y = int(command.position.y);
+        int r = int(command.size.x);
+
+        int offsetx = 0;
+        int offsety = r;
+        int d = r - 1;
+        int error = 0;
+
+        while (offsety >= offsetx)
+        {
+            error += SDL_RenderDrawLine(m_pRenderer, x - offsety, y + offsetx,
+                x + offsety, y + offsetx);
+            error += SDL_RenderDrawLine(m_pRenderer, x - offsetx, y + offsety,
+                x + offsetx, y + offsety);
+            error += SDL_RenderDrawLine(m_pRenderer, x - offsetx, y - offsety,
+                x + offsetx, y - offsety);
+            error += SDL_RenderDrawLine(m_pRenderer, x - offsety, y - offsetx,
+                x + offsety, y - offsetx);
+
+            if (error < 0)
+            {
+                break;
+            }
+
+            if (d >= 2 * offsetx)
+            {
+                d -= 2 * offsetx + 1;
+                offsetx += 1;
+            }
+            else if (d < 2 * (r - offsety))
+            {
+                d += 2 * offsety - 1;
+                offsety -= 1;
+            }
+            else
+            {
+                d += 2 * (offsety - offsetx - 1);
+                offsety -= 1;
+                offsetx += 1;
+            }
+        }
+
+        if (error < 0)
+        {
+            ErrorLogger::Write("Could not fill circle in HtGraphics::DrawShape().");
+            ErrorLogger::Write(SDL_GetError());
+            return Result::FAILURE;
+        }
+        break;
+    }
+    case RenderCommandType::SEGMENT:
+    {
+        if (SDL_RenderDrawLine(m_pRenderer, int(command.position.x), int(command.position.y),
+            int(command.position.x + command.size.x), int(command.position.y + command.size.y)) < 0)
+        {
+            ErrorLogger::Write("Could not draw line in HtGraphics::DrawShape().");
+            ErrorLogger::Write(SDL_GetError());
+            return Result::FAILURE;
+        }
+        break;
+    }
+    case RenderCommandType::POINTS:
+    {
+        if (SDL_RenderDrawPointsF(m_pRenderer, pPoints, command.numPoints) < 0)
+        {
+            ErrorLogger::Write("Could not draw points in HtGraphics::DrawShape().");
+            ErrorLogger::Write(SDL_GetError());
+            return Result::FAILURE;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return Result::SUCCESS;
+}
+
+void HtGraphics::SetDrawLayer(int layer)
+{
+    m_renderQueue.SetLayer(layer);
+}
+
+void HtGraphics::ClearDrawLayer()
+{
+    m_renderQueue.ClearLayer();
+}
+
+RenderStatistics HtGraphics::GetRenderStatistics() const
+{
+    return m_renderQueue.GetStatistics();
+}
+
+Result HtGraphics::FlushSprites()
+{
+    if (m_spriteBatch.Flush(m_pRenderer) < 0)
+    {
+        ErrorLogger::Write("Could not render sprite batch in HtGraphics::FlushSprites().");
+        ErrorLogger::Write(SDL_GetError());
+        return Result::FAILURE;
+    }
+    return Result::SUCCESS;
+}
+
+void HtGraphics::UseWholeTexture(Texture& texture)
+{
+    texture.sourceArea.x = 0;
+    texture.sourceArea.y = 0;
+    texture.sourceArea.w = texture.width;
+    texture.sourceArea.h = texture.height;
+    texture.uvArea.x = 0.0f;
+    texture.uvArea.y = 0.0f;
+    texture.uvArea.w = 1.0f;
+    texture.uvArea.h = 1.0f;
+    texture.inAtlas = false;
+}
+
 Result HtGraphics::SetRenderColour(const Colour& colour)
 {
     if (colour.r >= 0 && colour.r <= 255
@@ -838,6 +1075,7 @@ FontIndex HtGraphics::LoadFont(const std::string filename, int pointSize)
     if (pFont)
     {
         m_fontList.insert(std::pair<FontIndex, TTF_Font*>(m_nextFontIndex, pFont));
+        BuildGlyphs(m_nextFontIndex, pFont);
         m_nextFontIndex++;
         return m_nextFontIndex - 1;
     }
@@ -17,14 +17,24 @@
 // in case programmer just forgot to add the folder path.
 // Modified 10/6/24
 // Fixed WriteTextCentered angle.
+// Modified 17/10/26
+// DrawAt collects sprites in a SpriteBatch, so runs of the same picture are drawn together
+// LoadPicture packs small pictures into a TextureAtlas, so different pictures can share a batch
+// Text is drawn from glyphs rendered once by LoadFont, instead of creating a texture each call
+// Drawing functions queue commands in a RenderQueue, which Present() sorts and draws
+// Present() returns FAILURE if any of the queued drawing failed
 
 #pragma once
 #include "Vector2D.h"
 #include "Shapes.h"
 #include "Result.h"
+#include "SpriteBatch.h"
+#include "TextureAtlas.h"
+#include "RenderQueue.h"
 #include <map>
 #include "SDL.h"
 #include <string>
+#include <vector>
 #include "SDL_ttf.h"
 #pragma comment(lib, "SDL2_image")
 #pragma comment(lib, "SDL2_ttf")
@@ -44,6 +54,29 @@ struct Texture
     SDL_Texture* pTexture;
     int height;
     int width;
+    SDL_Rect sourceArea;    // The area of pTexture holding the picture, in pixels
+    SDL_FRect uvArea;       // The same area as fractions 0-1 of the size of pTexture
+    bool inAtlas;           // True if pTexture is an atlas page shared with other pictures
+};
+
+// The image and size of one character of a font, used internally by HtGraphics
+// to draw text without creating a texture each time
+struct Glyph
+{
+    SDL_Texture* pPage;     // The glyph atlas page holding the image, or nullptr if there is no image
+    SDL_FRect uvArea;       // The area of the page holding the image, as fractions 0-1 of the page size
+    int width;              // The size of the image in pixels
+    int height;
+    int offsetX;            // Where the image starts, relative to the pen position
+    int advance;            // How far to move the pen for the next character
+};
+
+// All the glyphs of a font, for characters FIRSTGLYPH to FIRSTGLYPH+NUMGLYPHS-1
+struct GlyphSet
+{
+    std::vector<Glyph> glyphs;
+    std::vector<int> kerning;   // Extra space between each pair of characters. NUMGLYPHS*first + second
+    int height;                 // The height of a line of text in pixels
 };
 
 // Stores a colour used by HtGraphics in various fuctions.
@@ -156,10 +189,9 @@ public:
     int GetHeightOfPicture(PictureIndex pic);
 
 
-    // Creates a picture from text. This can be used to create an image from text that will be used
-    // frequently in the game, which is more efficient than using the other text functions, which
-    // usually need to create an image each time. The image can be rendered using the same drawing functions
-    // that are used for images loaded from file
+    // Creates a picture from text. The image can be rendered using the same drawing functions
+    // that are used for images loaded from file. For text that is just written each frame,
+    // the other text functions are usually simpler, since they draw from glyphs prepared by LoadFont()
     // CAUTION CAUTION CAUTION - This function will create a new image each time it is called, even
     // if an identical image has been created previously. If you call this each frame, it will
     // create a lot of images, rapidly using up system resources.
@@ -170,6 +202,11 @@ public:
     // colour. Normally this is black, but can be changed using SetTransparentColour()
     PictureIndex CreatePictureFromText(const std::string text, FontIndex fontIndex, Colour textColour);
 
+    // The drawing functions below (DrawAt, Fill..., Draw... and Write...) do not draw
+    // straight away. They add to a queue that Present() draws. They only return FAILURE for
+    // problems found when they are called, such as a picture that has not been loaded.
+    // Errors from the renderer are reported by Present().
+
     // Draws the specified picture in the specified location, using the current camera settings
     // "centre" - The coordinates of the centre of the image
     // "picture" - The index of the requested picture, normally previously loaded using LoadImage()
@@ -204,8 +241,6 @@ public:
     Result DrawPointList(const Vector2D points[], Colour colour, const int numPoints);
 
     // Writes text at the specified location. The picture will be centred at the specified location.
-    // Note that this function is a bit slow. If you are drawing hundreds of samples of text each
-    // frame, this may cause some slowdown
     // "centre" - The coordinates of the centre of the text, using the current camera settings
     // "text" - The text
     // "colour" - The colour used for the text (the background will be transparent)
@@ -216,8 +251,6 @@ public:
 
     // Writes text at the specified location. The top left of the text will be the specified location,
     // which makes this function more useful for GUIs.
-    // Note that this function is a bit slow. If you are drawing hundreds of samples of text each
-    // frame, this may cause some slowdown
     // "topleft" - The coordinates of the top left of the text, using the current camera settings
     // "text" - The text
     // "colour" - The colour used for the text (the background will be transparent)
@@ -228,8 +261,6 @@ public:
 
     // Writes text at the specified location. The top left of the text will be the specified location,
     // which makes this function more useful for GUIs.
-    // Note that this function is a bit slow. If you are drawing hundreds of samples of text each
-    // frame, this may cause some slowdown
     // "topLeftX", "topLeftY" - The coordinates of the top left of the text, using the current camera settings
     // "text" - The text
     // "colour" - The colour used for the text (the background will be transparent)
@@ -239,8 +270,6 @@ public:
     Result WriteTextAligned(int topLeftX, int topLeftY, std::string text, Colour colour, FontIndex font = 0, double scale = 1.0);
 
     // Writes an integer at the specified location. The picture will be centred at the specified location.
-    // Note that this function is a bit slow. If you are drawing hundreds of samples of text each
-    // frame, this may cause some slowdown
     // "centre" - The coordinates of the centre of the text, using the current camera settings
     // "number" - The number
     // "colour" - The colour used for the text (the background will be transparent)
@@ -251,8 +280,6 @@ public:
 
     // Writes an integer at the specified location. The top left of the text will be the specified location,
     // which makes this function more useful for GUIs.
-    // Note that this function is a bit slow. If you are drawing hundreds of samples of text each
-    // frame, this may cause some slowdown
     // "topleft" - The coordinates of the top left of the text, using the current camera settings
     // "number" - The number
     // "colour" - The colour used for the text (the background will be transparent)
@@ -263,8 +290,6 @@ public:
 
     // Writes an integer at the specified location. The top left of the text will be the specified location,
     // which makes this function more useful for GUIs.
-    // Note that this function is a bit slow. If you are drawing hundreds of samples of text each
-    // frame, this may cause some slowdown
     // "topLeftX", "topLeftY" - The coordinates of the top left of the text, using the current camera settings
     // "number" - The number
     // "colour" - The colour used for the text (the background will be transparent)
@@ -274,8 +299,6 @@ public:
     Result WriteIntAligned(int topLeftX, int topLeftY, int number, Colour colour, FontIndex font = 0, double scale = 1.0);
 
     // Writes a floating point number at the specified location. The picture will be centred at the specified location.
-    // Note that this function is a bit slow. If you are drawing hundreds of samples of text each
-    // frame, this may cause some slowdown
     // "centre" - The coordinates of the centre of the text, using the current camera settings
     // "number" - The number
     // "colour" - The colour used for the text (the background will be transparent)
@@ -286,8 +309,6 @@ public:
 
     // Writes a floating point number at the specified location. The top left of the text will be the specified location,
     // which makes this function more useful for GUIs.
-    // Note that this function is a bit slow. If you are drawing hundreds of samples of text each
-    // frame, this may cause some slowdown
     // "topleft" - The coordinates of the top left of the text, using the current camera settings
     // "number" - The number
     // "colour" - The colour used for the text (the background will be transparent)
@@ -298,8 +319,6 @@ public:
 
     // Writes a floating point number at the specified location. The top left of the text will be the specified location,
     // which makes this function more useful for GUIs.
-    // Note that this function is a bit slow. If you are drawing hundreds of samples of text each
-    // frame, this may cause some slowdown
     // "topLeftX", "topLeftY" - The coordinates of the top left of the text, using the current camera settings
     // "number" - The number
     // "colour" - The colour used for the text (the background will be transparent)
@@ -320,12 +339,30 @@ public:
     // that give you in-game dimensions
     int GetWindowHeight() const;
 
+    // Sets the layer for everything drawn after this call, until ClearDrawLayer() is called.
+    // Lower layers are drawn first. Within a run of layers, drawing in the same layer
+    // may be reordered to group pictures using the same texture and shapes using the same colour.
+    // Shapes are drawn before pictures in the same layer.
+    // ObjectManager::RenderAll() uses each object's draw depth as the layer.
+    void SetDrawLayer(int layer);
+
+    // Drawing after this call is not reordered, and is drawn in the order of the calls.
+    // This is the default.
+    void ClearDrawLayer();
+
+    // Returns the number of drawing commands in the last frame, and how many changes
+    // of renderer state were needed to draw them before and after sorting
+    RenderStatistics GetRenderStatistics() const;
+
     // Presents the back buffer to the screen at the end of each frame of animation
     // This is normally called once in each game loop, once all drawing is complete.
     // Typically this will be called in Game::Update()
+    // Drawing functions do not draw straight away. Everything drawn since the
+    // last call is drawn here, before the back buffer is flipped.
     // The back buffer will be drawn (flipped) to the screen, and a new back buffer 
     // will be prepared. The new back buffer will be cleared, using the current
     // background colour (or texture), which is black by default.
+    // Returns FAILURE if any of the queued drawing failed. The screen is still updated.
     Result Present();
 
     // Closes down the class intance. This releases all resources.
@@ -378,10 +415,47 @@ private:
     PictureIndex m_backGroundTexture;       // The texture used as a background during Present. If less than 0, Present() will use the background colour instead
     int m_windowWidth;                      // The height of the window in pixels.
     int m_windowHeight;                     // The width of the window in pixels.
+    RenderQueue m_renderQueue;              // Everything drawn this frame, waiting for Present()
+    SpriteBatch m_spriteBatch;              // Sprites from the render queue waiting to be drawn
+    TextureAtlas m_atlas;                   // Pages holding pictures loaded by LoadPicture()
+    TextureAtlas m_glyphAtlas;              // Pages holding the glyphs of all loaded fonts
+    std::map<FontIndex, GlyphSet> m_glyphMap;   // Map of glyphs for each font
+    std::vector<int> m_glyphNumbers;        // Glyphs of the text being written. Kept to avoid allocating each time
+
+    // The range of characters that have glyphs. Other characters are shown as '?'
+    static const int FIRSTGLYPH = 32;
+    static const int NUMGLYPHS = 95;
 
     // Function used to set the current colour to be used by the SDL renderer
     Result SetRenderColour(const Colour& colour);
 
+    // Draws and empties the sprite batch. Called by DrawQueue() before anything else is drawn,
+    // so that sprites and other drawing stay in the order of the queue
+    Result FlushSprites();
+
+    // Adds a sprite to the render queue. Used by DrawAt() and for the glyphs of text.
+    // Uses native coordinates.
+    void QueueSprite(SDL_Texture* pTexture, const SDL_FRect& uvArea, float centreX, float centreY,
+        float width, float height, double angle, SDL_Color colour);
+
+    // Draws the commands in the render queue. Called by Present()
+    Result DrawQueue();
+
+    // Draws a command that is not a sprite. Called by DrawQueue() once the draw colour
+    // and blend mode have been set
+    Result DrawShape(const RenderCommand& command);
+
+    // Renders the printable characters of a font into the glyph atlas. Called by LoadFont()
+    void BuildGlyphs(FontIndex fontIndex, TTF_Font* pFont);
+
+    // Adds the glyphs of the text to the sprite batch. Called by the text functions.
+    // "position" is the centre of the text if "centred" is true, otherwise the top left.
+    // Uses native coordinates.
+    Result WriteGlyphs(Vector2D position, bool centred, const std::string& text, Colour colour, FontIndex font, double angle, double scale);
+
+    // Sets the texture to use the whole of its SDL texture, rather than part of an atlas page
+    void UseWholeTexture(Texture& texture);
+
     // Creates a texture from text. Called by CreatePictureFromText()
     Texture CreateTextureFromText(const std::string text, FontIndex fontIndex, Colour textColour);
 };
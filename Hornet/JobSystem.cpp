@@ -0,0 +1,159 @@
+#include "JobSystem.h"
+
+JobSystem JobSystem::instance;
+
+// True on a thread while it is running a job, so nested ParallelFor calls run directly
+static thread_local bool t_inJob = false;
+
+JobSystem::JobSystem()
+{
+	m_queuedJobs = 0;
+	m_stop = false;
+}
+
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+void JobSystem::Start()
+{
+	if (!m_threads.empty())
+		return;
+
+	// Leave one core for the calling thread
+	int numWorkers = (int)std::thread::hardware_concurrency() - 1;
+	if (numWorkers < 1)
+		numWorkers = 1;
+
+	m_stop = false;
+	m_queues.clear();
+	for (int i = 0; i <= numWorkers; ++i)
+	{
+		m_queues.emplace_back();
+	}
+	for (int i = 0; i < numWorkers; ++i)
+	{
+		m_threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+void JobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& next : m_threads)
+	{
+		next.join();
+	}
+	m_threads.clear();
+}
+
+int JobSystem::GetNumThreads()
+{
+	Start();
+	return (int)m_threads.size() + 1;
+}
+
+void JobSystem::ParallelFor(int count, int grainSize, const std::function<void(int begin, int end)>& function)
+{
+	if (count <= 0)
+		return;
+	if (grainSize < 1)
+		grainSize = 1;
+
+	// Not worth sharing, or already on a worker
+	if (count <= grainSize || t_inJob)
+	{
+		function(0, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> parallelLock(m_parallelForMutex);
+	Start();
+
+	int numJobs = (count + grainSize - 1) / grainSize;
+	std::atomic<int> remaining(numJobs);
+
+	// Deal the jobs out between the queues
+	int numQueues = (int)m_queues.size();
+	for (int i = 0; i < numJobs; ++i)
+	{
+		Job job = { &function, i * grainSize, std::min(count, (i + 1) * grainSize), &remaining };
+		JobQueue& queue = m_queues[i % numQueues];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_queuedJobs += numJobs;
+	}
+	m_wake.notify_all();
+
+	// Help out until everything has finished
+	int ownQueue = numQueues - 1;
+	Job job;
+	while (remaining > 0)
+	{
+		if (TakeJob(ownQueue, job))
+			RunJob(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+bool JobSystem::TakeJob(int queueIndex, Job& job)
+{
+	int numQueues = (int)m_queues.size();
+	for (int i = 0; i < numQueues; ++i)
+	{
+		JobQueue& queue = m_queues[(queueIndex + i) % numQueues];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			// Own jobs come from the back, stolen jobs from the front
+			if (i == 0)
+			{
+				job = queue.jobs.back();
+				queue.jobs.pop_back();
+			}
+			else
+			{
+				job = queue.jobs.front();
+				queue.jobs.pop_front();
+			}
+			--m_queuedJobs;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::RunJob(const Job& job)
+{
+	t_inJob = true;
+	(*job.pFunction)(job.begin, job.end);
+	t_inJob = false;
+	--(*job.pRemaining);
+}
+
+void JobSystem::WorkerLoop(int queueIndex)
+{
+	Job job;
+	while (true)
+	{
+		if (TakeJob(queueIndex, job))
+		{
+			RunJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wake.wait(lock, [this] { return m_stop || m_queuedJobs > 0; });
+		if (m_stop)
+			return;
+	}
+}
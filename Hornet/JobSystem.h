@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+// A pool of worker threads used to split work, such as updating objects,
+// across the processor's cores.
+// Each thread has its own queue of jobs. A thread that runs out of jobs "steals"
+// from the other queues, so the work stays balanced even if some jobs take longer.
+// The threads are started the first time they are needed.
+class JobSystem
+{
+public:
+	static JobSystem instance;
+
+	// Calls function(begin, end) for consecutive ranges covering 0 to count-1,
+	// using all worker threads and the calling thread. Returns when all have finished.
+	// If called from inside a job, the function is run on the calling thread instead.
+	// Parameters:
+	//  count - the number of items to process
+	//  grainSize - the number of items in each job. Larger values reduce overheads,
+	//              smaller values balance the work better.
+	//  function - called with the range of items to process. Must be safe to
+	//             call from several threads at once.
+	void ParallelFor(int count, int grainSize, const std::function<void(int begin, int end)>& function);
+
+	// Returns the number of threads that share the work, including the calling thread
+	int GetNumThreads();
+
+	// Stops and joins all worker threads. They are restarted if needed again.
+	void Shutdown();
+
+private:
+	struct Job
+	{
+		const std::function<void(int, int)>* pFunction;
+		int begin;
+		int end;
+		std::atomic<int>* pRemaining;	// Jobs still to finish in this ParallelFor
+	};
+
+	struct JobQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	std::vector<std::thread> m_threads;
+	std::deque<JobQueue> m_queues;		// One for each worker, and the last for the calling thread
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;		// Signalled when jobs are added, or when stopping
+	std::atomic<int> m_queuedJobs;		// Jobs added but not yet taken
+	bool m_stop;
+	std::mutex m_parallelForMutex;		// Only one ParallelFor at a time may use the queues
+
+	JobSystem();
+	~JobSystem();
+	JobSystem(const JobSystem& other) = delete;
+
+	// Starts the worker threads, if not already running
+	void Start();
+
+	// Takes a job from the end of the given queue, or steals one from the front of another.
+	// Returns false if there are no jobs.
+	bool TakeJob(int queueIndex, Job& job);
+
+	// Runs a job and records that it has finished
+	static void RunJob(const Job& job);
+
+	void WorkerLoop(int queueIndex);
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+// Refers to an object held by the ObjectManager. Unlike a pointer, a handle can
+// safely be kept after the object has been deleted: ObjectManager::Resolve
+// will then return nullptr instead of a dangling pointer.
+// Each slot in the ObjectManager's table has a generation number that changes whenever
+// its object is deleted, so an old handle never matches a new object using the same slot.
+struct ObjectHandle
+{
+	int index = -1;					// Slot in the ObjectManager's table. -1 for a null handle.
+	unsigned int generation = 0;	// Must match the slot's generation
+
+	// Returns true if the handle has never referred to an object
+	bool IsNull() const
+	{
+		return index < 0;
+	}
+
+	bool operator==(const ObjectHandle& other) const
+	{
+		return index == other.index && generation == other.generation;
+	}
+
+	bool operator!=(const ObjectHandle& other) const
+	{
+		return !(*this == other);
+	}
+};
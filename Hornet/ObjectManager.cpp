@@ -2,17 +2,76 @@
 #include "ObjectManager.h"
 #include <algorithm>
 #include "HtCamera.h"
+#include "ErrorLogger.h"
+#include "JobSystem.h"
+#include "Benchmarks.h"
 
 
 ObjectManager ObjectManager::instance;
 
+// If there are no more than this many objects of a type, FindClosestObject checks them all,
+// rather than searching the spatial index for the nearest of that type
+const size_t TYPESCANLIMIT = 64;
+
+// Thread-safe updates only use the job system if there are at least this many
+const size_t PARALLELUPDATEMIN = 256;
+
+// Number of objects updated by each job
+const int PARALLELUPDATEGRAIN = 128;
+
+// While a job is updating objects, the list that AddItem puts new objects in.
+// Each job has its own list, so objects are added in the same order every time.
+static thread_local std::vector<GameObject*>* t_pJobAdds = nullptr;
+
+// The broadphase must find at least this many pairs before they are tested on the job system
+const size_t PARALLELNARROWPHASEMIN = 1024;
+
+// Number of pairs tested by each job
+const int PARALLELNARROWPHASEGRAIN = 256;
+
+// Removes all inactive objects from a list where the order does not matter,
+// by moving the last object into each gap
+static void RemoveInactive(std::vector<GameObject*>& list)
+{
+	size_t i = 0;
+	while (i < list.size())
+	{
+		if (!list[i]->IsActive())
+		{
+			list[i] = list.back();
+			list.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+// Removes an object from a list where the order does not matter
+static void RemoveObject(std::vector<GameObject*>& list, GameObject* pObject)
+{
+	auto it = std::find(list.begin(), list.end(), pObject);
+	if (it != list.end())
+	{
+		*it = list.back();
+		list.pop_back();
+	}
+}
+
 ObjectManager::ObjectManager()
 {
 	m_currentScene = 0;
 	m_slowDownActive = false;
 	m_debugActive = false;
 	m_frametime = 0;
-    m_debugTarget = nullptr;
+	m_pCurrentScene = &GetPartition(m_currentScene);
+	m_freeHandleSlot = -1;
+	m_broadphase = BroadphaseType::SPATIALHASH;
+	m_numNarrowphaseTests = 0;
+	m_collisionTime = 1.0;
+	m_filteringCollisions = false;
+	m_contactFrame = 0;
 }
 
 ObjectManager::~ObjectManager()
@@ -24,31 +83,284 @@ void ObjectManager::AddItem(GameObject* pNewItem)
 {
 	if (pNewItem)
 	{
+		// May be called from worker threads
+		std::lock_guard<std::mutex> lock(m_commandMutex);
+
+		// Use current scene. Set before locking, so it is not treated as a change of scene.
+		pNewItem->SetSceneNumber(m_currentScene);
+
 		// Can't change certain things any longer, such as draw depth
 		pNewItem->Lock();
 
-		// Use current scene
-		pNewItem->SetSceneNumber(m_currentScene);
+		pNewItem->m_handle = AllocateHandle(pNewItem);
+		pNewItem->m_previousPosition = pNewItem->GetPosition();
+		if (t_pJobAdds)
+			t_pJobAdds->push_back(pNewItem);
+		else
+			m_pendingAdds.push_back(pNewItem);
+	}
+}
 
-		// Find position of first item with a higher or equal Draw Depth
+void ObjectManager::QueueRemoval(GameObject* pObject)
+{
+	// May be called from worker threads
+	std::lock_guard<std::mutex> lock(m_commandMutex);
+	m_pendingRemovals.push_back(pObject);
+}
+
+void ObjectManager::CommitChanges()
+{
+	CommitAdds();
+	ApplySceneChanges();
+}
+
+void ObjectManager::CommitAdds()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_commandMutex);
+		if (m_pendingAdds.empty())
+			return;
+		m_commitBuffer.swap(m_pendingAdds);
+	}
 
-		auto it = m_allObjectList.begin();
+	// Group by scene, so each scene is only looked up once
+	std::stable_sort(m_commitBuffer.begin(), m_commitBuffer.end(), [](const GameObject* pA, const GameObject* pB)
+		{
+			return pA->GetSceneNumber() < pB->GetSceneNumber();
+		});
 
-		while (it != m_allObjectList.end() && (*it)->GetDrawDepth() < pNewItem->GetDrawDepth())
+	ScenePartition* pScene = nullptr;
+	int sceneNumber = 0;
+	for (GameObject* pNext : m_commitBuffer)
+	{
+		if (!pScene || pNext->GetSceneNumber() != sceneNumber)
 		{
-			++it;
+			sceneNumber = pNext->GetSceneNumber();
+			pScene = &GetPartition(sceneNumber);
+		}
+		pScene->objects.push_back(pNext);
+		AddToSceneLists(*pScene, pNext);
+
+		// Deactivate() only queues objects that are already locked, so an object deactivated
+		// before AddItem (such as one that failed to initialise) must be queued here
+		if (!pNext->IsActive())
+			QueueRemoval(pNext);
+	}
+	m_commitBuffer.clear();
+}
+
+void ObjectManager::CommitRemovals()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_commandMutex);
+		if (m_pendingRemovals.empty())
+			return;
+		m_commitBuffer.swap(m_pendingRemovals);
+	}
+
+	// Find the scenes that have objects to delete. Only those need to be searched.
+	m_removalScenes.clear();
+	for (GameObject* pNext : m_commitBuffer)
+	{
+		// May have been activated again since
+		if (!pNext->IsActive())
+			m_removalScenes.push_back(pNext->m_partitionScene);
+	}
+	m_commitBuffer.clear();
+	std::sort(m_removalScenes.begin(), m_removalScenes.end());
+	m_removalScenes.erase(std::unique(m_removalScenes.begin(), m_removalScenes.end()), m_removalScenes.end());
+
+	for (int sceneNumber : m_removalScenes)
+	{
+		auto itp = m_scenes.find(sceneNumber);
+		if (itp == m_scenes.end())
+			continue;
+		ScenePartition& scene = itp->second;
+
+		// Remove all inactive objects from collider list
+		RemoveInactive(scene.colliders);
+
+		// Remove all inactive objects from event handler list
+		RemoveInactive(scene.eventHandlers);
+
+		// Remove all inactive objects from the type lists
+		for (std::vector<GameObject*>& ofType : scene.objectsByType)
+		{
+			RemoveInactive(ofType);
 		}
-		m_allObjectList.insert(it, pNewItem);
 
-		if (pNewItem->IsCollidable())
+		// Remove all inactive objects from the render queue, keeping the drawing order
+		for (auto& bucket : scene.renderQueue)
 		{
-			m_colliderList.push_back(pNewItem);
+			auto itr = std::remove_if(bucket.second.begin(), bucket.second.end(), [](GameObject* pGO) { return !pGO->IsActive(); });
+			bucket.second.erase(itr, bucket.second.end());
+		}
+
+		// Delete all inactive objects
+		auto it = scene.objects.begin();
+
+		for (; it != scene.objects.end(); ++it)
+		{
+			if (!(*it)->IsActive())
+			{
+				IndexObject(scene, *it);		// Removes it from the spatial index
+				DestroyObject(*it);
+				*it = nullptr;
+			}
 		}
-		if (pNewItem->CanHandleEvents())
+
+		// Remove all inactive objects from master list
+		auto ita = std::remove(scene.objects.begin(), scene.objects.end(), nullptr);
+		scene.objects.erase(ita, scene.objects.end());
+	}
+}
+
+ObjectHandle ObjectManager::AllocateHandle(GameObject* pObject)
+{
+	if (m_freeHandleSlot < 0)
+	{
+		m_handleSlots.push_back({ nullptr, 1, -1 });
+		m_freeHandleSlot = (int)m_handleSlots.size() - 1;
+	}
+
+	ObjectHandle handle;
+	handle.index = m_freeHandleSlot;
+	HandleSlot& slot = m_handleSlots[handle.index];
+	m_freeHandleSlot = slot.nextFree;
+	slot.pObject = pObject;
+	handle.generation = slot.generation;
+	return handle;
+}
+
+void ObjectManager::ReleaseHandle(ObjectHandle handle)
+{
+	if (handle.index >= 0 && handle.index < (int)m_handleSlots.size())
+	{
+		HandleSlot& slot = m_handleSlots[handle.index];
+		slot.pObject = nullptr;
+		++slot.generation;		// Existing handles no longer match
+		slot.nextFree = m_freeHandleSlot;
+		m_freeHandleSlot = handle.index;
+	}
+}
+
+GameObject* ObjectManager::Resolve(ObjectHandle handle) const
+{
+	if (handle.index < 0 || handle.index >= (int)m_handleSlots.size())
+		return nullptr;
+
+	const HandleSlot& slot = m_handleSlots[handle.index];
+	if (slot.generation != handle.generation)
+		return nullptr;
+	return slot.pObject;
+}
+
+ObjectManager::ScenePartition& ObjectManager::GetPartition(int sceneNumber)
+{
+	return m_scenes[sceneNumber];
+}
+
+void ObjectManager::InsertIntoPartition(GameObject* pObject)
+{
+	ScenePartition& scene = GetPartition(pObject->GetSceneNumber());
+	scene.objects.push_back(pObject);
+	AddToSceneLists(scene, pObject);
+}
+
+void ObjectManager::AddToSceneLists(ScenePartition& scene, GameObject* pObject)
+{
+	pObject->m_partitionScene = pObject->GetSceneNumber();
+
+	scene.renderQueue[pObject->GetDrawDepth()].push_back(pObject);
+	if (pObject->IsCollidable())
+	{
+		scene.colliders.push_back(pObject);
+	}
+	if (pObject->CanHandleEvents())
+	{
+		scene.eventHandlers.push_back(pObject);
+	}
+	GetTypeList(scene, pObject->GetType()).push_back(pObject);
+
+	IndexObject(scene, pObject);
+}
+
+bool ObjectManager::RemoveFromPartition(GameObject* pObject, ScenePartition& scene)
+{
+	auto it = std::find(scene.objects.begin(), scene.objects.end(), pObject);
+	if (it == scene.objects.end())
+		return false;
+	scene.objects.erase(it);
+
+	std::vector<GameObject*>& bucket = scene.renderQueue[pObject->GetDrawDepth()];
+	bucket.erase(std::find(bucket.begin(), bucket.end(), pObject));
+
+	RemoveObject(scene.colliders, pObject);
+	RemoveObject(scene.eventHandlers, pObject);
+	RemoveObject(GetTypeList(scene, pObject->GetType()), pObject);
+
+	if (pObject->m_spatialProxy != AABBTree::NULLPROXY)
+	{
+		scene.spatialIndex.DestroyProxy(pObject->m_spatialProxy);
+		pObject->m_spatialProxy = AABBTree::NULLPROXY;
+	}
+	return true;
+}
+
+ObjectPool& ObjectManager::AddPool(size_t slotSize, const char* name)
+{
+	std::lock_guard<std::mutex> lock(m_poolMutex);
+	m_pools.emplace_back(slotSize, name);
+	return m_pools.back();
+}
+
+void ObjectManager::DestroyObject(GameObject* pObject)
+{
+	ReleaseHandle(pObject->m_handle);
+
+	ObjectPool* pPool = pObject->m_pPool;
+	if (pPool)
+	{
+		// The pool slot starts at the most derived object, not necessarily at the GameObject
+		void* pSlot = dynamic_cast<void*>(pObject);
+		pObject->~GameObject();
+		pPool->Free(pSlot);
+	}
+	else
+	{
+		delete pObject;
+	}
+}
+
+void ObjectManager::GetPoolStatistics(std::vector<PoolStatistics>& results) const
+{
+	std::lock_guard<std::mutex> lock(m_poolMutex);
+	for (const ObjectPool& next : m_pools)
+	{
+		results.push_back(next.GetStatistics());
+	}
+}
+
+void ObjectManager::QueueSceneChange(GameObject* pObject)
+{
+	m_sceneChanges.push_back(pObject);
+}
+
+void ObjectManager::ApplySceneChanges()
+{
+	for (GameObject* pNext : m_sceneChanges)
+	{
+		// May have been queued more than once, or changed back again
+		if (pNext->m_partitionScene != pNext->GetSceneNumber())
 		{
-			m_eventHandlerList.push_back(pNewItem);
+			auto it = m_scenes.find(pNext->m_partitionScene);
+			if (it != m_scenes.end() && RemoveFromPartition(pNext, it->second))
+			{
+				InsertIntoPartition(pNext);
+			}
 		}
 	}
+	m_sceneChanges.clear();
 }
 
 // Returns a pointer to the closest active object of a given type to 
@@ -57,66 +369,311 @@ GameObject* ObjectManager::FindClosestObject(Vector2D location, ObjectType ot)
 {
 	GameObject* pClosest = nullptr;
 	double distance2 = 9e9f;	// A very long way away.
-	for (GameObject* pNext : m_allObjectList)
+
+	// If there are only a few, just check them all
+	const std::vector<GameObject*>& ofType = GetTypeList(*m_pCurrentScene, ot);
+	if (ofType.size() <= TYPESCANLIMIT)
 	{
-		if (pNext &&
-			pNext->GetType() == ot &&           // Is the correct type of object
-			pNext->GetSceneNumber() == m_currentScene &&  // Is in the current active scene
-			pNext->IsActive() &&                          // Is active
-			(pNext->GetPosition() - location).magnitudeSquared() < distance2)     // Is closer than the previous closest
+		for (GameObject* pNext : ofType)
 		{
-			distance2 = (pNext->GetPosition() - location).magnitudeSquared();
-			pClosest = pNext;
+			if (pNext->GetSceneNumber() == m_currentScene &&  // Has not just left the current scene
+				pNext->IsActive() &&                          // Is active
+				(pNext->GetPosition() - location).magnitudeSquared() < distance2)     // Is closer than the previous closest
+			{
+				distance2 = (pNext->GetPosition() - location).magnitudeSquared();
+				pClosest = pNext;
+			}
 		}
+		return pClosest;
 	}
+
+	// Every object's box in the index contains its position, so the search can
+	// stop once the remaining boxes are further away than the closest object so far.
+	m_pCurrentScene->spatialIndex.Nearest(location, distance2, [&](int proxy)
+		{
+			GameObject* pNext = m_pCurrentScene->spatialIndex.GetObject(proxy);
+			if (pNext->GetType() == ot &&           // Is the correct type of object
+				pNext->GetSceneNumber() == m_currentScene &&  // Is in the current active scene
+				pNext->IsActive() &&                          // Is active
+				(pNext->GetPosition() - location).magnitudeSquared() < distance2)     // Is closer than the previous closest
+			{
+				distance2 = (pNext->GetPosition() - location).magnitudeSquared();
+				pClosest = pNext;
+			}
+			return distance2;
+		});
 	return pClosest;
 }
 
-std::vector<GameObject*> ObjectManager::GetAllObjectsOfType(ObjectType ot)
+int ObjectManager::FindKNearestObjects(Vector2D location, ObjectType ot, int k, GameObject** results)
 {
-	std::vector<GameObject*> answer;
-	for (GameObject* pNext : m_allObjectList)
+	if (k <= 0)
+		return 0;
+
+	// "results" is kept as a heap, with the furthest of the objects found so far at the top
+	int numResults = 0;
+	auto closer = [&location](GameObject* pA, GameObject* pB)
+		{
+			return (pA->GetPosition() - location).magnitudeSquared() < (pB->GetPosition() - location).magnitudeSquared();
+		};
+
+	// Keeps the object if it is one of the closest so far. Returns the square of
+	// the distance that other objects must be within to be kept.
+	auto consider = [&](GameObject* pNext)
+		{
+			if (pNext->GetType() == ot &&                     // Is the correct type of object
+				pNext->GetSceneNumber() == m_currentScene &&  // Is in the current active scene
+				pNext->IsActive())                            // Is active
+			{
+				if (numResults < k)
+				{
+					results[numResults] = pNext;
+					++numResults;
+					std::push_heap(results, results + numResults, closer);
+				}
+				else if (closer(pNext, results[0]))
+				{
+					std::pop_heap(results, results + k, closer);
+					results[k - 1] = pNext;
+					std::push_heap(results, results + k, closer);
+				}
+			}
+			return (numResults < k) ? 9e9 : (results[0]->GetPosition() - location).magnitudeSquared();
+		};
+
+	// If there are only a few, just check them all
+	const std::vector<GameObject*>& ofType = GetTypeList(*m_pCurrentScene, ot);
+	if (ofType.size() <= TYPESCANLIMIT)
 	{
-		if (pNext &&
-			pNext->GetType() == ot &&           // Is the correct type of object
-			pNext->GetSceneNumber() == m_currentScene)  // Is in the current active scene
+		for (GameObject* pNext : ofType)
 		{
-			answer.push_back(pNext);
+			consider(pNext);
 		}
 	}
-	return answer;
+	else
+	{
+		// As FindClosestObject, but the search can only stop once it has found k objects
+		m_pCurrentScene->spatialIndex.Nearest(location, 9e9, [&](int proxy)
+			{
+				return consider(m_pCurrentScene->spatialIndex.GetObject(proxy));
+			});
+	}
+
+	std::sort_heap(results, results + numResults, closer);
+	return numResults;
 }
 
-void ObjectManager::DeleteInactiveItems()
+void ObjectManager::FindObjectsInRegion(const Rectangle2D& region, std::vector<GameObject*>& results)
 {
+	m_pCurrentScene->spatialIndex.Query(region, [&](int proxy)
+		{
+			GameObject* pNext = m_pCurrentScene->spatialIndex.GetObject(proxy);
+			if (pNext->IsActive() && pNext->GetSceneNumber() == m_currentScene)
+			{
+				if (pNext->IsCollidable())
+				{
+					if (pNext->GetCollisionShape().Intersects(region))
+						results.push_back(pNext);
+				}
+				else if (region.Intersects(Point2D(pNext->GetPosition())))
+				{
+					results.push_back(pNext);
+				}
+			}
+			return true;
+		});
+}
 
-	// Remove all inactive objects from collider list
-	auto itc = std::remove_if(m_colliderList.begin(), m_colliderList.end(), [](GameObject* pGO) { return !pGO->IsActive(); });
-	m_colliderList.erase(itc, m_colliderList.end());
-
-	// Remove all inactive objects from event handler list
-	auto ite = std::remove_if(m_eventHandlerList.begin(), m_eventHandlerList.end(), [](GameObject* pGO) { return !pGO->IsActive(); });
-	m_colliderList.erase(ite, m_eventHandlerList.end());
+void ObjectManager::FindObjectsAlongSegment(const Segment2D& segment, std::vector<GameObject*>& results)
+{
+	// Objects found, with the fraction of the way along the segment where it reaches their box
+	std::vector<std::pair<double, GameObject*>> hits;
 
-	// Delete all inactive objects
-	auto it = m_allObjectList.begin();
+	m_pCurrentScene->spatialIndex.RayCast(segment, [&](int proxy, double entry)
+		{
+			GameObject* pNext = m_pCurrentScene->spatialIndex.GetObject(proxy);
+			if (pNext->IsActive() && pNext->GetSceneNumber() == m_currentScene &&
+				pNext->IsCollidable() && pNext->GetCollisionShape().Intersects(segment))
+			{
+				hits.push_back({ entry, pNext });
+			}
+			return true;
+		});
 
-	for (; it != m_allObjectList.end(); ++it)
+	std::stable_sort(hits.begin(), hits.end(),
+		[](const std::pair<double, GameObject*>& a, const std::pair<double, GameObject*>& b)
+		{
+			return a.first < b.first;
+		});
+	for (const auto& hit : hits)
 	{
-		if (!(*it)->IsActive())
+		results.push_back(hit.second);
+	}
+}
+
+int ObjectManager::FindObjectsInRadius(Vector2D centre, double radius, GameObject** results, int maxResults)
+{
+	Vector2D halfSize(radius, radius);
+	return FindObjectsInArea(Circle2D(centre, radius), Rectangle2D(centre - halfSize, centre + halfSize), nullptr, results, maxResults);
+}
+
+int ObjectManager::FindObjectsInRadius(Vector2D centre, double radius, ObjectType ot, GameObject** results, int maxResults)
+{
+	Vector2D halfSize(radius, radius);
+	return FindObjectsInArea(Circle2D(centre, radius), Rectangle2D(centre - halfSize, centre + halfSize), &ot, results, maxResults);
+}
+
+int ObjectManager::FindObjectsInRegion(const Rectangle2D& region, GameObject** results, int maxResults)
+{
+	return FindObjectsInArea(region, region, nullptr, results, maxResults);
+}
+
+int ObjectManager::FindObjectsInRegion(const Rectangle2D& region, ObjectType ot, GameObject** results, int maxResults)
+{
+	return FindObjectsInArea(region, region, &ot, results, maxResults);
+}
+
+bool ObjectManager::IsInArea(GameObject* pObject, const IShape2D& area) const
+{
+	if (!pObject->IsActive() || pObject->GetSceneNumber() != m_currentScene)
+		return false;
+	if (pObject->IsCollidable())
+		return pObject->GetCollisionShape().Intersects(area);
+	return area.Intersects(Point2D(pObject->GetPosition()));
+}
+
+int ObjectManager::FindObjectsInArea(const IShape2D& area, const Rectangle2D& bounds, const ObjectType* pType,
+	GameObject** results, int maxResults)
+{
+	int numResults = 0;
+	if (maxResults <= 0)
+		return 0;
+
+	m_pCurrentScene->spatialIndex.Query(bounds, [&](int proxy)
 		{
-#ifdef _DEBUG
-			if(*it == m_debugTarget)
-				m_debugTarget = nullptr;
-#endif // DEBUG
-			delete* it;
-			*it = nullptr;
-		}
+			GameObject* pNext = m_pCurrentScene->spatialIndex.GetObject(proxy);
+			if ((!pType || pNext->GetType() == *pType) && IsInArea(pNext, area))
+			{
+				results[numResults] = pNext;
+				++numResults;
+			}
+			return numResults < maxResults;		// Stop when full
+		});
+	return numResults;
+}
+
+GameObject* ObjectManager::FindFirstObjectAlongSegment(const Segment2D& segment, double& fraction, unsigned int mask)
+{
+	GameObject* pFirst = nullptr;
+	double first = 1.0;
+	Vector2D start = segment.GetStart();
+	Vector2D direction = segment.GetEnd() - start;
+
+	m_pCurrentScene->spatialIndex.RayCast(segment, [&](int proxy, double entry)
+		{
+			// Can't be hit before the segment reaches its box
+			if (entry > first)
+				return true;
+
+			GameObject* pNext = m_pCurrentScene->spatialIndex.GetObject(proxy);
+			if (!pNext->IsActive() || pNext->GetSceneNumber() != m_currentScene ||
+				!pNext->IsCollidable() || !(pNext->GetCollisionCategory() & mask))
+				return true;
+
+			// Is it hit before the closest so far?
+			const IShape2D& shape = pNext->GetCollisionShape();
+			Segment2D part;
+			part.PlaceAt(start, start + direction * first);
+			if (!shape.Intersects(part))
+				return true;
+
+			// Halve the search range until it is very small. The part of the segment
+			// up to "hit" always hits the shape, and up to "miss" never does.
+			double miss = entry;
+			double hit = first;
+			for (int i = 0; i < 40 && hit - miss > 1e-9; ++i)
+			{
+				double middle = (miss + hit) / 2;
+				part.PlaceAt(start, start + direction * middle);
+				if (shape.Intersects(part))
+					hit = middle;
+				else
+					miss = middle;
+			}
+			first = hit;
+			pFirst = pNext;
+			return true;
+		});
+
+	if (pFirst)
+		fraction = first;
+	return pFirst;
+}
+
+Rectangle2D ObjectManager::GetSpatialBounds(GameObject* pObject)
+{
+	Vector2D position = pObject->GetPosition();
+	if (!pObject->IsCollidable())
+		return Rectangle2D(position, position);
+
+	Rectangle2D box = pObject->GetCollisionShape().GetBoundingBox();
+	Vector2D bottomLeft = box.GetBottomLeft();
+	Vector2D topRight = box.GetTopRight();
+
+	// Include where it was at the start of the frame, if its collisions are swept
+	if (pObject->UsesContinuousCollision())
+	{
+		Vector2D back = pObject->m_previousPosition - position;
+		bottomLeft = Vector2D(std::min(bottomLeft.XValue, bottomLeft.XValue + back.XValue), std::min(bottomLeft.YValue, bottomLeft.YValue + back.YValue));
+		topRight = Vector2D(std::max(topRight.XValue, topRight.XValue + back.XValue), std::max(topRight.YValue, topRight.YValue + back.YValue));
+	}
+	return Rectangle2D(Vector2D(std::min(bottomLeft.XValue, position.XValue), std::min(bottomLeft.YValue, position.YValue)),
+		Vector2D(std::max(topRight.XValue, position.XValue), std::max(topRight.YValue, position.YValue)));
+}
+
+void ObjectManager::IndexObject(ScenePartition& scene, GameObject* pObject)
+{
+	if (pObject->IsActive())
+	{
+		if (pObject->m_spatialProxy == AABBTree::NULLPROXY)
+			pObject->m_spatialProxy = scene.spatialIndex.CreateProxy(GetSpatialBounds(pObject), pObject);
+		else
+			scene.spatialIndex.MoveProxy(pObject->m_spatialProxy, GetSpatialBounds(pObject));
+	}
+	else if (pObject->m_spatialProxy != AABBTree::NULLPROXY)
+	{
+		scene.spatialIndex.DestroyProxy(pObject->m_spatialProxy);
+		pObject->m_spatialProxy = AABBTree::NULLPROXY;
+	}
+}
+
+void ObjectManager::UpdateSpatialIndex()
+{
+	for (GameObject* pNext : m_pCurrentScene->objects)
+	{
+		IndexObject(*m_pCurrentScene, pNext);
 	}
+}
+
+ObjectView ObjectManager::GetAllObjectsOfType(ObjectType ot)
+{
+	const std::vector<GameObject*>& ofType = GetTypeList(*m_pCurrentScene, ot);
+	return ObjectView(ofType.data(), ofType.data() + ofType.size());
+}
 
-	// Remove all inactive objects from master list
-	auto ita = std::remove(m_allObjectList.begin(), m_allObjectList.end(), nullptr);
-	m_allObjectList.erase(ita, m_allObjectList.end());
+std::vector<GameObject*>& ObjectManager::GetTypeList(ScenePartition& scene, ObjectType type)
+{
+	size_t index = (size_t)type;
+	if (index >= scene.objectsByType.size())
+		scene.objectsByType.resize(index + 1);
+	return scene.objectsByType[index];
+}
+
+void ObjectManager::DeleteInactiveItems()
+{
+	// Objects must be in the right place before deleting
+	CommitChanges();
+	CommitRemovals();
 }
 
 void ObjectManager::UpdateAll(double frametime)
@@ -129,77 +686,553 @@ void ObjectManager::UpdateAll(double frametime)
 
 	m_frametime = frametime;
 
-	auto it = m_allObjectList.begin();
+	// Catch up with anything that changed since the last update, such as objects
+	// added, moved by collisions or changing scene
+	CommitChanges();
+	UpdateSpatialIndex();
+
+	// The scene is held separately, in case an object changes the current scene.
+	ScenePartition& scene = *m_pCurrentScene;
+
+	// Update objects that allow it on the worker threads first
+	m_parallelObjects.clear();
+	for (GameObject* pNext : scene.objects)
+	{
+		// Where each object starts, for continuous collision detection
+		pNext->m_previousPosition = pNext->GetPosition();
+
+		if (pNext->IsThreadSafeUpdate() && pNext->IsActive() && pNext->GetSceneNumber() == m_currentScene)
+		{
+			m_parallelObjects.push_back(pNext);
+		}
+	}
+	bool parallel = m_parallelObjects.size() >= PARALLELUPDATEMIN;
+	if (parallel)
+	{
+		int numJobs = ((int)m_parallelObjects.size() + PARALLELUPDATEGRAIN - 1) / PARALLELUPDATEGRAIN;
+		if ((int)m_jobAdds.size() < numJobs)
+			m_jobAdds.resize(numJobs);
+
+		float time = float(frametime);
+		JobSystem::instance.ParallelFor((int)m_parallelObjects.size(), PARALLELUPDATEGRAIN, [this, time](int begin, int end)
+			{
+				t_pJobAdds = &m_jobAdds[begin / PARALLELUPDATEGRAIN];
+				for (int i = begin; i < end; ++i)
+				{
+					m_parallelObjects[i]->Update(time);
+				}
+				t_pJobAdds = nullptr;
+			});
+
+		// Queue the new objects in job order, as if they had been updated one at a time
+		{
+			std::lock_guard<std::mutex> lock(m_commandMutex);
+			for (int job = 0; job < numJobs; ++job)
+			{
+				m_pendingAdds.insert(m_pendingAdds.end(), m_jobAdds[job].begin(), m_jobAdds[job].end());
+				m_jobAdds[job].clear();
+			}
+		}
+
+		for (GameObject* pNext : m_parallelObjects)
+		{
+			IndexObject(scene, pNext);
+		}
+	}
 
-	for (; it != m_allObjectList.end(); ++it)
+	// Update the rest in order.
+	// Objects added while updating are not added to the scene until the updates finish.
+	for (GameObject* pNext : scene.objects)
 	{
-		if ((*it)->IsActive() && (*it)->GetSceneNumber() == m_currentScene)
+		if (pNext->IsActive() && pNext->GetSceneNumber() == m_currentScene &&
+			!(parallel && pNext->IsThreadSafeUpdate()))
 		{
-			(*it)->Update(float(frametime));
+			pNext->Update(float(frametime));
+
+			// Keeps searches during the rest of the update accurate.
+			// Cheap unless the object has left its fattened box.
+			IndexObject(scene, pNext);
 		}
 	}
+
+	// Add the objects created during the update, so they can collide and be drawn this frame
+	CommitChanges();
 }
 
 void ObjectManager::RenderAll()
 {
-	auto it = m_allObjectList.begin();
+	CommitChanges();
 
-	for (; it != m_allObjectList.end(); ++it)
+	// Lower draw depths first. The depth is also the graphics layer, so HtGraphics
+	// regroups the drawing within each depth by texture, and shapes by colour, to
+	// reduce state changes. The most recently added object is still drawn first, but
+	// only among drawing with the same texture, or shapes with the same colour.
+	// Objects that must overlap in a particular order need different draw depths.
+	for (auto& bucket : m_pCurrentScene->renderQueue)
 	{
-		if ((*it)->IsActive() && (*it)->GetSceneNumber() == m_currentScene)
+		HtGraphics::instance.SetDrawLayer(bucket.first);
+		for (auto it = bucket.second.rbegin(); it != bucket.second.rend(); ++it)
 		{
-			(*it)->Render();
+			GameObject* pNext = *it;
+			if (pNext->IsActive() && pNext->GetSceneNumber() == m_currentScene)
+			{
+				pNext->Render();
+			}
 		}
 	}
-
+	HtGraphics::instance.ClearDrawLayer();
 }
 
 void ObjectManager::ProcessCollisions()
 {
-	//  collisions
-	auto it1 = m_colliderList.begin();
+	CommitChanges();
+	ScenePartition& scene = *m_pCurrentScene;
+	++m_contactFrame;
+
+	// Gather the colliders that can take part this frame, and copy their shapes
+	// into one array so the tests below do not need to read the objects
+	m_activeColliders.clear();
+	m_colliderShapes.clear();
+	m_colliderCategories.clear();
+	m_colliderMasks.clear();
+	m_colliderMovements.clear();
+	m_filteringCollisions = false;
+	for (GameObject* pNext : scene.colliders)
+	{
+		if (pNext->IsActive())
+		{
+			m_activeColliders.push_back(pNext);
+			m_colliderShapes.push_back(ToShapeValue(pNext->GetCollisionShape()));
+			m_colliderCategories.push_back(pNext->GetCollisionCategory());
+			m_colliderMasks.push_back(pNext->GetCollisionMask());
+			if (pNext->GetCollisionMask() != ALLCOLLISIONCATEGORIES || pNext->GetCollisionCategory() == 0)
+				m_filteringCollisions = true;
+
+			// Only circles and points can be swept
+			ShapeKind kind = pNext->GetCollisionShape().GetKind();
+			if (pNext->UsesContinuousCollision() && (kind == ShapeKind::CIRCLE || kind == ShapeKind::POINT))
+				m_colliderMovements.push_back(pNext->GetPosition() - pNext->m_previousPosition);
+			else
+				m_colliderMovements.push_back(Vector2D(0, 0));
+		}
+	}
+
+	if (m_broadphase == BroadphaseType::BRUTEFORCE)
+	{
+		ProcessCollisionsBruteForce();
+		EndContacts();
+		return;
+	}
 
-	for (; it1 != m_colliderList.end(); ++it1)
+	// Find the pairs whose bounding boxes overlap
+	m_colliderBounds.clear();
+	for (int i = 0; i < (int)m_colliderShapes.size(); ++i)
 	{
-		auto it2 = it1;
-		it2++;
+		Rectangle2D box = WithShape(m_colliderShapes[i], [](const IShape2D& shape) { return shape.GetBoundingBox(); });
 
-		for (; it2 != m_colliderList.end(); ++it2)
+		// Swept colliders cover the whole of their movement
+		const Vector2D& movement = m_colliderMovements[i];
+		if (movement.XValue != 0 || movement.YValue != 0)
 		{
-			if ((*it1)->IsActive() && (*it2)->IsActive()
-				&& (*it1)->GetSceneNumber() == m_currentScene
-				&& (*it2)->GetSceneNumber() == m_currentScene)
-			{
-				if ((*it1)->HasCollided(**it2))
+			Vector2D bottomLeft = box.GetBottomLeft();
+			Vector2D topRight = box.GetTopRight();
+			box = Rectangle2D(Vector2D(std::min(bottomLeft.XValue, bottomLeft.XValue - movement.XValue), std::min(bottomLeft.YValue, bottomLeft.YValue - movement.YValue)),
+				Vector2D(std::max(topRight.XValue, topRight.XValue - movement.XValue), std::max(topRight.YValue, topRight.YValue - movement.YValue)));
+		}
+		m_colliderBounds.push_back(box);
+	}
+
+	// Pairs that the filters do not allow are left out as they are found
+	CollisionFilter filter = { &m_colliderCategories, &m_colliderMasks };
+	const CollisionFilter* pFilter = m_filteringCollisions ? &filter : nullptr;
+
+	m_collisionPairs.clear();
+	if (m_broadphase == BroadphaseType::SWEEPANDPRUNE)
+	{
+		scene.sweepAndPrune.FindPairs(m_activeColliders, m_colliderBounds, m_collisionPairs, pFilter);
+	}
+	else if (m_broadphase == BroadphaseType::AABBTREE)
+	{
+		UpdateSpatialIndex();
+
+		// Look up which collider each proxy belongs to
+		m_proxyColliderIndex.assign(scene.spatialIndex.GetCapacity(), -1);
+		for (int i = 0; i < (int)m_activeColliders.size(); ++i)
+		{
+			m_proxyColliderIndex[m_activeColliders[i]->m_spatialProxy] = i;
+		}
+
+		for (int i = 0; i < (int)m_activeColliders.size(); ++i)
+		{
+			const Rectangle2D& box = m_colliderBounds[i];
+			scene.spatialIndex.Query(box, [&](int proxy)
 				{
-					(*it1)->ProcessCollision(**it2);
-					(*it2)->ProcessCollision(**it1);
-				}
+					// Only record each pair once, from the collider with the lower index
+					int j = m_proxyColliderIndex[proxy];
+					if (j > i && CanCollide(i, j) && BoxesOverlap(box, m_colliderBounds[j]))
+						m_collisionPairs.push_back({ i, j });
+					return true;
+				});
+		}
+		std::sort(m_collisionPairs.begin(), m_collisionPairs.end());
+	}
+	else
+	{
+		m_spatialHash.SetCellSize(scene.cellSize);
+		m_spatialHash.FindPairs(m_colliderBounds, m_collisionPairs, pFilter);
+	}
+
+	// Test those pairs properly. Pairs are sorted, so objects are told about
+	// collisions in the same order as with BRUTEFORCE.
+	m_numNarrowphaseTests = (int)m_collisionPairs.size();
+	if (m_collisionPairs.size() >= PARALLELNARROWPHASEMIN)
+	{
+		ProcessCollisionPairsInParallel();
+	}
+	else
+	{
+		for (const CollisionPair& pair : m_collisionPairs)
+		{
+			GameObject* pFirst = m_activeColliders[pair.first];
+			GameObject* pSecond = m_activeColliders[pair.second];
+
+			// No need to test if an earlier collision this frame deactivated one of them
+			double time;
+			if (pFirst->IsActive() && pSecond->IsActive() && TestColliders(pair.first, pair.second, time))
+			{
+				ReportCollision(pFirst, pSecond, time);
+			}
+		}
+	}
+	EndContacts();
+}
+
+bool ObjectManager::TestColliders(int first, int second, double& time) const
+{
+	const Vector2D& firstMovement = m_colliderMovements[first];
+	const Vector2D& secondMovement = m_colliderMovements[second];
+	bool firstSwept = firstMovement.XValue != 0 || firstMovement.YValue != 0;
+	bool secondSwept = secondMovement.XValue != 0 || secondMovement.YValue != 0;
+	if (!firstSwept && !secondSwept)
+	{
+		time = 1.0;
+		return ShapesIntersect(m_colliderShapes[first], m_colliderShapes[second]);
+	}
+
+	// Sweep one that moved against the other where it ends up, using their movement
+	// relative to each other. The swept one is a circle or a point.
+	int mover = firstSwept ? first : second;
+	int other = firstSwept ? second : first;
+	Vector2D relativeMovement = m_colliderMovements[mover] - m_colliderMovements[other];
+
+	Circle2D moving;
+	const ShapeValue& moverShape = m_colliderShapes[mover];
+	if (moverShape.kind == ShapeKind::CIRCLE)
+		moving = ToCircle2D(moverShape);
+	else
+		moving.PlaceAt(ToPoint2D(moverShape).GetPosition(), 0);
+	moving.PlaceAt(moving.GetCentre() - relativeMovement, moving.GetRadius());
+
+	return WithShape(m_colliderShapes[other], [&](const IShape2D& shape)
+		{
+			return moving.Sweep(relativeMovement, shape, time);
+		});
+}
+
+void ObjectManager::ReportCollision(GameObject* pFirst, GameObject* pSecond, double time)
+{
+	// An earlier collision this frame may have deactivated one of them
+	if (pFirst->IsActive() && pSecond->IsActive())
+	{
+		bool newContact = RecordContact(pFirst, pSecond);
+
+		m_collisionTime = time;
+		pFirst->ProcessCollision(*pSecond);
+		pSecond->ProcessCollision(*pFirst);
+		if (newContact)
+		{
+			pFirst->OnCollisionEnter(*pSecond);
+			pSecond->OnCollisionEnter(*pFirst);
+		}
+		else
+		{
+			pFirst->OnCollisionStay(*pSecond);
+			pSecond->OnCollisionStay(*pFirst);
+		}
+	}
+}
+
+bool ObjectManager::RecordContact(GameObject* pFirst, GameObject* pSecond)
+{
+	ObjectHandle first = pFirst->GetHandle();
+	ObjectHandle second = pSecond->GetHandle();
+	if (second.index < first.index)
+		std::swap(first, second);
+
+	Contact& contact = m_contacts[ContactKey(first, second)];
+
+	// A new entry has null handles. Different handles mean that a handle slot has been
+	// reused since the old contact, so it is also new.
+	bool isNew = (contact.first != first || contact.second != second);
+	contact.first = first;
+	contact.second = second;
+	contact.frame = m_contactFrame;
+	return isNew;
+}
+
+unsigned long long ObjectManager::ContactKey(ObjectHandle first, ObjectHandle second)
+{
+	return ((unsigned long long)(unsigned int)first.index << 32) | (unsigned int)second.index;
+}
+
+void ObjectManager::EndContacts()
+{
+	m_endedContacts.clear();
+	for (auto it = m_contacts.begin(); it != m_contacts.end();)
+	{
+		if (it->second.frame != m_contactFrame)
+		{
+			m_endedContacts.push_back(it->second);
+			it = m_contacts.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	// Report them in a fixed order, rather than the order of the hash table
+	std::sort(m_endedContacts.begin(), m_endedContacts.end(), [](const Contact& a, const Contact& b)
+		{
+			return ContactKey(a.first, a.second) < ContactKey(b.first, b.second);
+		});
+
+	for (const Contact& contact : m_endedContacts)
+	{
+		// Can't tell an object about one that has been deleted
+		GameObject* pFirst = Resolve(contact.first);
+		GameObject* pSecond = Resolve(contact.second);
+		if (pFirst && pSecond)
+		{
+			pFirst->OnCollisionExit(*pSecond);
+			pSecond->OnCollisionExit(*pFirst);
+		}
+	}
+}
+
+double ObjectManager::GetCollisionTime() const
+{
+	return m_collisionTime;
+}
+
+void ObjectManager::ProcessCollisionsBruteForce()
+{
+	// Sort the colliders by shape. Swept colliders are not batched.
+	// The lists stay in collider order.
+	m_shapeBatch.Clear();
+	m_batchCircles.clear();
+	m_batchRectangles.clear();
+	m_unbatchedColliders.clear();
+	int numColliders = (int)m_activeColliders.size();
+	for (int i = 0; i < numColliders; ++i)
+	{
+		const ShapeValue& shape = m_colliderShapes[i];
+		const Vector2D& movement = m_colliderMovements[i];
+		if (movement.XValue != 0 || movement.YValue != 0)
+		{
+			m_unbatchedColliders.push_back(i);
+		}
+		else if (shape.kind == ShapeKind::CIRCLE)
+		{
+			m_shapeBatch.AddCircle(ToCircle2D(shape));
+			m_batchCircles.push_back(i);
+		}
+		else if (shape.kind == ShapeKind::RECTANGLE)
+		{
+			m_shapeBatch.AddRectangle(ToRectangle2D(shape));
+			m_batchRectangles.push_back(i);
+		}
+		else
+		{
+			m_unbatchedColliders.push_back(i);
+		}
+	}
+
+	m_numNarrowphaseTests = numColliders * (numColliders - 1) / 2;
+	m_collisionTimes.resize(numColliders);
+	for (int i = 0; i < numColliders; ++i)
+	{
+		// Find everything later in the list that this collider hits.
+		// The time of each hit is kept in m_collisionTimes, by collider.
+		m_colliderHits.clear();
+		const ShapeValue& shape = m_colliderShapes[i];
+		const Vector2D& movement = m_colliderMovements[i];
+		bool swept = movement.XValue != 0 || movement.YValue != 0;
+		if (!swept && (shape.kind == ShapeKind::CIRCLE || shape.kind == ShapeKind::RECTANGLE))
+		{
+			FindBatchHits(i, true);
+			FindBatchHits(i, false);
+			for (int j : m_colliderHits)
+			{
+				m_collisionTimes[j] = 1.0;
+			}
+			auto first = std::upper_bound(m_unbatchedColliders.begin(), m_unbatchedColliders.end(), i);
+			for (auto it = first; it != m_unbatchedColliders.end(); ++it)
+			{
+				if (CanCollide(i, *it) && TestColliders(i, *it, m_collisionTimes[*it]))
+					m_colliderHits.push_back(*it);
+			}
+			std::sort(m_colliderHits.begin(), m_colliderHits.end());
+		}
+		else
+		{
+			for (int j = i + 1; j < numColliders; ++j)
+			{
+				if (CanCollide(i, j) && TestColliders(i, j, m_collisionTimes[j]))
+					m_colliderHits.push_back(j);
+			}
+		}
+
+		for (int j : m_colliderHits)
+		{
+			ReportCollision(m_activeColliders[i], m_activeColliders[j], m_collisionTimes[j]);
+		}
+	}
+}
+
+void ObjectManager::FindBatchHits(int collider, bool circles)
+{
+	const ShapeValue& shape = m_colliderShapes[collider];
+	bool isCircle = shape.kind == ShapeKind::CIRCLE;
+	Circle2D circle;
+	Rectangle2D rectangle;
+	if (isCircle)
+		circle = ToCircle2D(shape);
+	else
+		rectangle = ToRectangle2D(shape);
+	const std::vector<int>& batched = circles ? m_batchCircles : m_batchRectangles;
+
+	int first = (int)(std::upper_bound(batched.begin(), batched.end(), collider) - batched.begin());
+	int numBatched = (int)batched.size();
+	for (int start = first; start < numBatched; start += ShapeBatch::MAXTESTS)
+	{
+		int count = std::min(numBatched - start, ShapeBatch::MAXTESTS);
+		uint32_t hits;
+		if (circles)
+			hits = isCircle ? m_shapeBatch.TestCircles(circle, start, count) : m_shapeBatch.TestCircles(rectangle, start, count);
+		else
+			hits = isCircle ? m_shapeBatch.TestRectangles(circle, start, count) : m_shapeBatch.TestRectangles(rectangle, start, count);
+
+		for (int n = 0; hits != 0; ++n, hits >>= 1)
+		{
+			if ((hits & 1) && CanCollide(collider, batched[start + n]))
+				m_colliderHits.push_back(batched[start + n]);
+		}
+	}
+}
+
+void ObjectManager::ProcessCollisionPairsInParallel()
+{
+	// Each job lists the pairs in its range that collide
+	int numPairs = (int)m_collisionPairs.size();
+	int numJobs = (numPairs + PARALLELNARROWPHASEGRAIN - 1) / PARALLELNARROWPHASEGRAIN;
+	if ((int)m_jobCollisions.size() < numJobs)
+		m_jobCollisions.resize(numJobs);
+	m_collisionTimes.resize(numPairs);
+
+	// ParallelFor may use fewer, larger ranges (it runs the whole range at once when
+	// called from inside a job), so clear every list first rather than in each job
+	for (int job = 0; job < numJobs; ++job)
+	{
+		m_jobCollisions[job].clear();
+	}
+
+	JobSystem::instance.ParallelFor(numPairs, PARALLELNARROWPHASEGRAIN, [this](int begin, int end)
+		{
+			std::vector<int>& hits = m_jobCollisions[begin / PARALLELNARROWPHASEGRAIN];
+			for (int i = begin; i < end; ++i)
+			{
+				const CollisionPair& pair = m_collisionPairs[i];
+				if (TestColliders(pair.first, pair.second, m_collisionTimes[i]))
+					hits.push_back(i);
 			}
+		});
+
+	// Jobs cover the pairs in order, so taking their results in job order keeps the pairs
+	// sorted, and the callbacks happen in the same order every time
+	for (int job = 0; job < numJobs; ++job)
+	{
+		for (int i : m_jobCollisions[job])
+		{
+			ReportCollision(m_activeColliders[m_collisionPairs[i].first], m_activeColliders[m_collisionPairs[i].second], m_collisionTimes[i]);
 		}
 	}
 }
 
+void ObjectManager::SetBroadphase(BroadphaseType type)
+{
+	m_broadphase = type;
+}
+
+BroadphaseType ObjectManager::GetBroadphase() const
+{
+	return m_broadphase;
+}
+
+void ObjectManager::SetCellSize(int sceneNumber, double cellSize)
+{
+	if (cellSize > 0)
+	{
+		GetPartition(sceneNumber).cellSize = cellSize;
+	}
+#ifdef _DEBUG
+	else
+		ErrorLogger::Write("You have called SetCellSize() with a cell size that is not positive.");
+#endif // DEBUG
+}
+
+double ObjectManager::GetCellSize(int sceneNumber) const
+{
+	auto it = m_scenes.find(sceneNumber);
+	if (it == m_scenes.end())
+		return SpatialHash::DEFAULTCELLSIZE;
+	else
+		return it->second.cellSize;
+}
+
 
 int ObjectManager::GetNumObjects() const
 {
-	return (int)m_allObjectList.size();
+	size_t count = m_pendingAdds.size();
+	for (const auto& next : m_scenes)
+	{
+		count += next.second.objects.size();
+	}
+	return (int)count;
 }
 
 void ObjectManager::DeleteAllObjects()
 {
-	auto it = m_allObjectList.begin();
-
-	for (; it != m_allObjectList.end(); ++it)
+	for (auto& next : m_scenes)
 	{
-		delete* it;
+		for (GameObject* pNext : next.second.objects)
+		{
+			DestroyObject(pNext);
+		}
+	}
+	for (GameObject* pNext : m_pendingAdds)
+	{
+		DestroyObject(pNext);
 	}
 
-	m_allObjectList.clear();
-	m_colliderList.clear();
-	m_eventHandlerList.clear();
+	m_scenes.clear();
+	m_sceneChanges.clear();
+	m_contacts.clear();
+	m_pendingAdds.clear();
+	m_pendingRemovals.clear();
+	m_pCurrentScene = &GetPartition(m_currentScene);
 #ifdef _DEBUG
-	m_debugTarget = nullptr;
+	m_debugTarget = ObjectHandle();
 #endif // DEBUG
 
 
@@ -207,11 +1240,17 @@ void ObjectManager::DeleteAllObjects()
 
 void ObjectManager::HandleEvent(Event evt)
 {
-	auto it = m_eventHandlerList.begin();
+	// Fill in the handle, so receivers can keep it safely
+	if (evt.source.IsNull() && evt.pSource)
+		evt.source = evt.pSource->GetHandle();
 
-	for (; it != m_eventHandlerList.end(); ++it)
+	// Objects added during the event are not added until later, so do not receive it
+	for (auto& next : m_scenes)
 	{
-		(*it)->HandleEvent(evt);
+		for (GameObject* pNext : next.second.eventHandlers)
+		{
+			pNext->HandleEvent(evt);
+		}
 	}
 }
 
@@ -220,6 +1259,7 @@ void ObjectManager::HandleEvent(Event evt)
 void ObjectManager::SetCurrentScene(int sceneNumber)
 {
 	m_currentScene = sceneNumber;
+	m_pCurrentScene = &GetPartition(sceneNumber);
 }
 
 // Returns the number of the current scene.
@@ -231,36 +1271,68 @@ int ObjectManager::GetCurrentScene()
 // Sets ALL objects to inactive.
 void ObjectManager::DeactivateAll()
 {
-	auto it = m_allObjectList.begin();
+	for (auto& next : m_scenes)
+	{
+		for (GameObject* pNext : next.second.objects)
+		{
+			pNext->Deactivate();
+		}
+	}
 
-	for (; it != m_allObjectList.end(); ++it)
+	// Also objects that have not been committed yet
+	for (GameObject* pNext : m_pendingAdds)
 	{
-		(*it)->Deactivate();
+		pNext->Deactivate();
 	}
 }
 
 // Deactivates all objects with the corresponding type
 void ObjectManager::DeactivateType(ObjectType type)
 {
-	auto it = m_allObjectList.begin();
+	for (GameObject* pNext : GetTypeList(*m_pCurrentScene, type))
+	{
+		if (pNext->GetSceneNumber() == m_currentScene)
+			pNext->Deactivate();
+	}
 
-	for (; it != m_allObjectList.end(); ++it)
+	// Also objects that have just been added or moved into the current scene
+	for (GameObject* pNext : m_pendingAdds)
 	{
-		if ((*it) && (*it)->GetSceneNumber() == m_currentScene &&
-			(*it)->GetType() == type)
-			(*it)->Deactivate();
+		if (pNext->GetSceneNumber() == m_currentScene && pNext->GetType() == type)
+			pNext->Deactivate();
+	}
+	for (GameObject* pNext : m_sceneChanges)
+	{
+		if (pNext->GetSceneNumber() == m_currentScene && pNext->GetType() == type)
+			pNext->Deactivate();
 	}
 }
 
 // Deactivates all objects with the specified scene
 void ObjectManager::DeactivateScene(int sceneNumber)
 {
-	auto it = m_allObjectList.begin();
+	auto itp = m_scenes.find(sceneNumber);
+	if (itp != m_scenes.end())
+	{
+		auto it = itp->second.objects.begin();
+
+		for (; it != itp->second.objects.end(); ++it)
+		{
+			if ((*it)->GetSceneNumber() == sceneNumber)
+				(*it)->Deactivate();
+		}
+	}
 
-	for (; it != m_allObjectList.end(); ++it)
+	// Also objects that have just been added or moved into the scene
+	for (GameObject* pNext : m_pendingAdds)
 	{
-		if ((*it)->GetSceneNumber() == sceneNumber)
-			(*it)->Deactivate();
+		if (pNext->GetSceneNumber() == sceneNumber)
+			pNext->Deactivate();
+	}
+	for (GameObject* pNext : m_sceneChanges)
+	{
+		if (pNext->GetSceneNumber() == sceneNumber)
+			pNext->Deactivate();
 	}
 }
 
@@ -280,61 +1352,81 @@ void ObjectManager::CycleDebugObject()
 	if (HtKeyboard::instance.NewKeyPressed(SDL_SCANCODE_HOME))
 	{
 		SetDebug(true);
-		if (m_allObjectList.size() > 0)
-			m_debugTarget = *m_allObjectList.begin();
+		if (m_pCurrentScene->objects.size() > 0)
+			m_debugTarget = (*m_pCurrentScene->objects.begin())->GetHandle();
 		else
-			m_debugTarget = nullptr;
+			m_debugTarget = ObjectHandle();
 	}
 	if (HtKeyboard::instance.NewKeyPressed(SDL_SCANCODE_END))
 	{
 		SetDebug(false);
-			m_debugTarget = nullptr;
+			m_debugTarget = ObjectHandle();
 	}
 	if (HtKeyboard::instance.NewKeyPressed(SDL_SCANCODE_INSERT))
 	{
 		m_slowDownActive = !m_slowDownActive;
 	}
+	if (m_debugActive && HtKeyboard::instance.NewKeyPressed(SDL_SCANCODE_DELETE))
+	{
+		// Switch broadphase, so the results can be compared
+		if (m_broadphase == BroadphaseType::SPATIALHASH)
+			m_broadphase = BroadphaseType::SWEEPANDPRUNE;
+		else if (m_broadphase == BroadphaseType::SWEEPANDPRUNE)
+			m_broadphase = BroadphaseType::AABBTREE;
+		else if (m_broadphase == BroadphaseType::AABBTREE)
+			m_broadphase = BroadphaseType::BRUTEFORCE;
+		else
+			m_broadphase = BroadphaseType::SPATIALHASH;
+	}
+	if (m_debugActive && HtKeyboard::instance.NewKeyPressed(SDL_SCANCODE_F9))
+	{
+		m_benchmarkResults = Benchmarks::RunAll();
+		for (const std::string& line : m_benchmarkResults)
+		{
+			ErrorLogger::Write(line);
+		}
+	}
 	if (m_debugActive && HtKeyboard::instance.NewKeyPressed(SDL_SCANCODE_PAGEUP))
 	{
-		if (m_allObjectList.size() > 0)
+		if (m_pCurrentScene->objects.size() > 0)
 		{
-			auto it = std::find(m_allObjectList.begin(), m_allObjectList.end(), m_debugTarget);
-			if (it == m_allObjectList.end())
+			auto it = std::find(m_pCurrentScene->objects.begin(), m_pCurrentScene->objects.end(), Resolve(m_debugTarget));
+			if (it == m_pCurrentScene->objects.end())
 			{
-				it = m_allObjectList.begin();
-				m_debugTarget = *it;
+				it = m_pCurrentScene->objects.begin();
+				m_debugTarget = (*it)->GetHandle();
 			}
 			else
 			{
 				++it;
-				if (it != m_allObjectList.end())
-					m_debugTarget = *it;
+				if (it != m_pCurrentScene->objects.end())
+					m_debugTarget = (*it)->GetHandle();
 				else
 				{
-					m_debugTarget = nullptr;
+					m_debugTarget = ObjectHandle();
 				}
 			}
 		}
 		else
 		{
-			m_debugTarget = nullptr;
+			m_debugTarget = ObjectHandle();
 		}
 	}
 	if (m_debugActive && HtKeyboard::instance.NewKeyPressed(SDL_SCANCODE_PAGEDOWN))
 	{
-		if (m_allObjectList.size() > 0)
+		if (m_pCurrentScene->objects.size() > 0)
 		{
-			auto it = std::find(m_allObjectList.begin(), m_allObjectList.end(), m_debugTarget);
-			if (it == m_allObjectList.begin()) // If current target is first, cyle to end
+			auto it = std::find(m_pCurrentScene->objects.begin(), m_pCurrentScene->objects.end(), Resolve(m_debugTarget));
+			if (it == m_pCurrentScene->objects.begin()) // If current target is first, cyle to end
 			{
-				it = m_allObjectList.end();
+				it = m_pCurrentScene->objects.end();
 			}
 			it--;
-			m_debugTarget = *it;
+			m_debugTarget = (*it)->GetHandle();
 		}
 		else
 		{
-			m_debugTarget = nullptr;
+			m_debugTarget = ObjectHandle();
 		}
 	}
 }
@@ -350,7 +1442,7 @@ void ObjectManager::RenderDebug()
 
 		// Number of objects
 		HtGraphics::instance.WriteTextAligned(-1400, 990, "Num objects: ", HtGraphics::LIGHTGREEN, 2);
-		HtGraphics::instance.WriteIntAligned(-800, 990, (int)m_allObjectList.size(), HtGraphics::LIGHTGREEN, 2);
+		HtGraphics::instance.WriteIntAligned(-800, 990, GetNumObjects(), HtGraphics::LIGHTGREEN, 2);
 
 		// Frame time
 		HtGraphics::instance.WriteTextAligned(-1400, 950, "Frame Time: ", HtGraphics::LIGHTGREEN, 2);
@@ -358,8 +1450,43 @@ void ObjectManager::RenderDebug()
 		// Frame rate
 		HtGraphics::instance.WriteTextAligned(-1400, 910, "Frame Rate: ", HtGraphics::LIGHTGREEN, 2);
 		HtGraphics::instance.WriteFloatAligned(-800, 910, 60 / m_frametime, HtGraphics::LIGHTGREEN, 2);
+		// Collision tests
+		HtGraphics::instance.WriteTextAligned(-200, 990, "Broadphase: ", HtGraphics::LIGHTGREEN, 2);
+		if (m_broadphase == BroadphaseType::SPATIALHASH)
+			HtGraphics::instance.WriteTextAligned(400, 990, "Spatial hash", HtGraphics::LIGHTGREEN, 2);
+		else if (m_broadphase == BroadphaseType::SWEEPANDPRUNE)
+			HtGraphics::instance.WriteTextAligned(400, 990, "Sweep and prune", HtGraphics::LIGHTGREEN, 2);
+		else if (m_broadphase == BroadphaseType::AABBTREE)
+			HtGraphics::instance.WriteTextAligned(400, 990, "AABB tree", HtGraphics::LIGHTGREEN, 2);
+		else
+			HtGraphics::instance.WriteTextAligned(400, 990, "Brute force", HtGraphics::LIGHTGREEN, 2);
+		HtGraphics::instance.WriteTextAligned(-200, 950, "Shape tests: ", HtGraphics::LIGHTGREEN, 2);
+		HtGraphics::instance.WriteIntAligned(400, 950, m_numNarrowphaseTests, HtGraphics::LIGHTGREEN, 2);
+		// Pooled objects, totalled over all pools
+		int pooled = 0;
+		int poolCapacity = 0;
+		int poolPeak = 0;
+		std::vector<PoolStatistics> poolStatistics;
+		GetPoolStatistics(poolStatistics);
+		for (const PoolStatistics& stats : poolStatistics)
+		{
+			pooled += stats.inUse;
+			poolCapacity += stats.capacity;
+			poolPeak += stats.highWaterMark;
+		}
+		HtGraphics::instance.WriteTextAligned(-200, 910, "Pooled: ", HtGraphics::LIGHTGREEN, 2);
+		HtGraphics::instance.WriteIntAligned(400, 910, pooled, HtGraphics::LIGHTGREEN, 2);
+		HtGraphics::instance.WriteTextAligned(-200, 870, "Pool slots: ", HtGraphics::LIGHTGREEN, 2);
+		HtGraphics::instance.WriteIntAligned(400, 870, poolCapacity, HtGraphics::LIGHTGREEN, 2);
+		HtGraphics::instance.WriteTextAligned(-200, 830, "Pool peak: ", HtGraphics::LIGHTGREEN, 2);
+		HtGraphics::instance.WriteIntAligned(400, 830, poolPeak, HtGraphics::LIGHTGREEN, 2);
 		if (m_slowDownActive)
 			HtGraphics::instance.WriteTextAligned(-1400, 870, "Slowdown engaged ", HtGraphics::RED, 2);
+		// Results of the last benchmark run
+		for (size_t i = 0; i < m_benchmarkResults.size(); ++i)
+		{
+			HtGraphics::instance.WriteTextAligned(-200, 750 - 40 * (int)i, m_benchmarkResults[i], HtGraphics::LIGHTGREEN, 2);
+		}
 
 		
 
@@ -368,9 +1495,10 @@ void ObjectManager::RenderDebug()
 
 		HtCamera::instance.UseCamera(cameraPreviouslyActive);
 
-		if (m_debugTarget)
+		GameObject* pTarget = Resolve(m_debugTarget);
+		if (pTarget)
 		{
-			m_debugTarget->RenderDebugShape();
+			pTarget->RenderDebugShape();
 		}
 	}
 }
@@ -378,9 +1506,10 @@ void ObjectManager::RenderDebug()
 void ObjectManager::RenderDebugObject()
 {
 	// Display information for the current target
-	if (m_debugActive && m_debugTarget)
+	GameObject* pTarget = Resolve(m_debugTarget);
+	if (m_debugActive && pTarget)
 	{
-		m_debugTarget->RenderDebug();
+		pTarget->RenderDebug();
 	}
 }
 
@@ -1,20 +1,272 @@
 #pragma once
 
 #include "GameObject.h"
+#include <vector>
+#include <map>
+#include <unordered_map>
 #include <list>
+#include <typeinfo>
+#include <utility>
+#include <mutex>
 #include "gametimer.h"
+#include "Broadphase.h"
+#include "SpatialHash.h"
+#include "SweepAndPrune.h"
+#include "AABBTree.h"
+#include "ObjectPool.h"
+#include "ShapeBatch.h"
+
+// A read-only list of objects held by the ObjectManager, such as the result of
+// GetAllObjectsOfType. It does not copy the objects, so it is cheap to get every frame.
+// It points into the ObjectManager's own lists, which are changed when objects are
+// added, deleted or change scene. These changes are made by UpdateAll, RenderAll,
+// ProcessCollisions and DeleteInactiveItems, so a view must not be kept across any of
+// those calls. Copy it into a std::vector if you need to keep it for longer.
+class ObjectView
+{
+private:
+	GameObject* const* m_pBegin;
+	GameObject* const* m_pEnd;
+public:
+	ObjectView(GameObject* const* pBegin, GameObject* const* pEnd) : m_pBegin(pBegin), m_pEnd(pEnd)
+	{
+	}
+
+	GameObject* const* begin() const
+	{
+		return m_pBegin;
+	}
+
+	GameObject* const* end() const
+	{
+		return m_pEnd;
+	}
+
+	// Returns the number of objects
+	size_t size() const
+	{
+		return m_pEnd - m_pBegin;
+	}
+
+	bool empty() const
+	{
+		return m_pBegin == m_pEnd;
+	}
+
+	GameObject* operator[](size_t index) const
+	{
+		return m_pBegin[index];
+	}
+};
 
 class ObjectManager
 {
 private:
-	std::list<GameObject*> m_allObjectList;
-	std::list<GameObject*> m_colliderList;
-	std::list<GameObject*> m_eventHandlerList;
+	// The objects belonging to one scene. Each scene is kept separately, so
+	// that each frame only touches objects in the current scene.
+	struct ScenePartition
+	{
+		std::vector<GameObject*> objects;		// In the order they were added, which is the order they are updated
+		std::map<int, std::vector<GameObject*>> renderQueue;	// The objects in a bucket for each draw depth.
+																// Each bucket is in the order the objects were added.
+		std::vector<GameObject*> colliders;		// In no particular order
+		std::vector<GameObject*> eventHandlers;	// In no particular order
+		std::vector<std::vector<GameObject*>> objectsByType;	// Indexed by ObjectType. In no particular order
+		AABBTree spatialIndex;					// Active objects in the scene, used for collisions and searches
+		SweepAndPrune sweepAndPrune;			// Kept between frames, so each scene has its own
+		double cellSize = SpatialHash::DEFAULTCELLSIZE;		// Spatial hash cell size for this scene
+	};
+
+	std::map<int, ScenePartition> m_scenes;
+	ScenePartition* m_pCurrentScene;	// The partition for m_currentScene
+	std::vector<GameObject*> m_sceneChanges;	// Objects that have changed scene, but not yet moved partition
+	std::vector<GameObject*> m_parallelObjects;	// Objects being updated on worker threads
+	std::vector<std::vector<GameObject*>> m_jobAdds;	// Objects added by each job updating m_parallelObjects
+
+	// Objects are not added to or removed from the scenes straight away, since the lists may be in use.
+	// Instead, the changes are queued and applied together by CommitChanges and DeleteInactiveItems.
+	std::vector<GameObject*> m_pendingAdds;		// Objects passed to AddItem
+	std::vector<GameObject*> m_pendingRemovals;	// Objects that have been deactivated. May contain duplicates.
+	std::mutex m_commandMutex;			// Protects m_pendingAdds and m_pendingRemovals, which worker threads may use
+	std::vector<GameObject*> m_commitBuffer;	// Working space for committing changes
+	std::vector<int> m_removalScenes;			// Scenes with objects to delete
 	int m_currentScene;
 	bool m_debugActive;
 	bool m_slowDownActive;
 	double m_frametime;
-	GameObject* m_debugTarget;
+	ObjectHandle m_debugTarget;
+	std::vector<std::string> m_benchmarkResults;	// Shown on the debug display after F9 is pressed
+	BroadphaseType m_broadphase;		// The method used to find possible collisions
+	SpatialHash m_spatialHash;
+	std::vector<GameObject*> m_activeColliders;		// The colliders being checked in ProcessCollisions
+	std::vector<Rectangle2D> m_colliderBounds;		// Bounding boxes of each of m_activeColliders
+	std::vector<CollisionPair> m_collisionPairs;	// Possible collisions found by the broadphase
+	std::vector<ShapeValue> m_colliderShapes;		// Copies of the collision shapes of each of m_activeColliders
+	std::vector<unsigned int> m_colliderCategories;	// Collision category of each of m_activeColliders
+	std::vector<unsigned int> m_colliderMasks;		// Collision mask of each of m_activeColliders
+	bool m_filteringCollisions;						// True if any of m_activeColliders has a non-default filter
+	std::vector<Vector2D> m_colliderMovements;		// Movement this frame of each of m_activeColliders that is swept.
+													// Zero for those tested only where they end up.
+	std::vector<double> m_collisionTimes;			// Time of impact of each collision found. Indexed by pair when testing
+													// m_collisionPairs in parallel, or by collider in BRUTEFORCE.
+	double m_collisionTime;							// Time of impact of the collision being reported
+
+	// Two objects that were colliding in a ProcessCollisions
+	struct Contact
+	{
+		ObjectHandle first;		// The one with the lower handle index
+		ObjectHandle second;
+		unsigned int frame;		// The last ProcessCollisions in which they were colliding
+	};
+	std::unordered_map<unsigned long long, Contact> m_contacts;	// Objects that are colliding, keyed by ContactKey()
+	unsigned int m_contactFrame;					// Counts calls to ProcessCollisions
+	std::vector<Contact> m_endedContacts;			// Working space for EndContacts
+	ShapeBatch m_shapeBatch;						// The circles and rectangles of m_activeColliders, when using BRUTEFORCE
+	std::vector<int> m_batchCircles;				// Index in m_activeColliders of each circle in m_shapeBatch
+	std::vector<int> m_batchRectangles;				// Index in m_activeColliders of each rectangle in m_shapeBatch
+	std::vector<int> m_unbatchedColliders;			// Indices in m_activeColliders of colliders of other shapes
+	std::vector<int> m_colliderHits;				// Indices in m_activeColliders that one collider hits
+	std::vector<std::vector<int>> m_jobCollisions;	// Indices in m_collisionPairs that collide, found by each narrowphase job
+	int m_numNarrowphaseTests;			// Number of pairs of shapes tested in the last ProcessCollisions
+	std::vector<int> m_proxyColliderIndex;		// Index in m_activeColliders of each proxy in the spatial index, or -1
+	std::list<ObjectPool> m_pools;		// One for each type of object made using Create
+	mutable std::mutex m_poolMutex;		// Protects m_pools, since Create may be called from worker threads
+
+	// An entry in the table used to look up handles
+	struct HandleSlot
+	{
+		GameObject* pObject;		// nullptr if not in use
+		unsigned int generation;	// Increased each time the object using this slot is deleted
+		int nextFree;				// The next unused slot, if this one is not in use
+	};
+	std::vector<HandleSlot> m_handleSlots;
+	int m_freeHandleSlot;				// The first unused slot, or -1
+
+	// GameObject::SetSceneNumber calls QueueSceneChange and GameObject::Deactivate calls QueueRemoval
+	friend class GameObject;
+
+	// Returns the partition for a scene, creating it if needed
+	ScenePartition& GetPartition(int sceneNumber);
+
+	// Adds the object to the partition for its scene
+	void InsertIntoPartition(GameObject* pObject);
+
+	// Adds the object to the partition's collider, event handler and type lists, and its spatial index.
+	// Does not add it to the list of objects.
+	void AddToSceneLists(ScenePartition& scene, GameObject* pObject);
+
+	// Records that an object has been deactivated, so it is deleted by DeleteInactiveItems
+	void QueueRemoval(GameObject* pObject);
+
+	// Adds the objects passed to AddItem, then moves objects that have changed scene
+	void CommitChanges();
+
+	// Adds the objects passed to AddItem to their scenes.
+	// Any that were deactivated before AddItem are queued for deletion.
+	void CommitAdds();
+
+	// Deletes deactivated objects. Only searches the scenes they are in.
+	void CommitRemovals();
+
+	// Removes the object from the partition.
+	// Returns false if the object was not in it.
+	bool RemoveFromPartition(GameObject* pObject, ScenePartition& scene);
+
+	// Records that an object has changed scene. It is moved to its new partition
+	// by ApplySceneChanges, since it may be in a partition that is being updated.
+	void QueueSceneChange(GameObject* pObject);
+
+	// Moves objects that have changed scene into their new partition
+	void ApplySceneChanges();
+
+	// Returns the box used for the object in the spatial index.
+	// For collidable objects, this covers the collision shape and the position.
+	// For other objects, it is just the position.
+	Rectangle2D GetSpatialBounds(GameObject* pObject);
+
+	// Adds, moves or removes the object in the scene's spatial index, depending on
+	// whether it is active
+	void IndexObject(ScenePartition& scene, GameObject* pObject);
+
+	// Calls IndexObject for every object in the current scene
+	void UpdateSpatialIndex();
+
+	// Creates a new pool for objects of the given size
+	ObjectPool& AddPool(size_t slotSize, const char* name);
+
+	// Returns the pool used for objects of type T
+	template<typename T>
+	ObjectPool& GetPool()
+	{
+		static ObjectPool* pPool = &AddPool(sizeof(T), typeid(T).name());
+		return *pPool;
+	}
+
+	// Returns true if the collision filters of colliders "first" and "second"
+	// in m_activeColliders allow them to collide
+	inline bool CanCollide(int first, int second) const
+	{
+		return (m_colliderCategories[first] & m_colliderMasks[second]) && (m_colliderCategories[second] & m_colliderMasks[first]);
+	}
+
+	// Returns true if colliders "first" and "second" in m_activeColliders intersect,
+	// sweeping them if either uses continuous collision detection.
+	// Sets "time" to the fraction of the frame's movement at which they first touch.
+	// Safe to call from several threads at once.
+	bool TestColliders(int first, int second, double& time) const;
+
+	// Calls ProcessCollision, and OnCollisionEnter or OnCollisionStay, for both objects,
+	// unless an earlier collision this frame has deactivated either of them
+	void ReportCollision(GameObject* pFirst, GameObject* pSecond, double time);
+
+	// Records that the two objects are colliding in this ProcessCollisions.
+	// Returns true if they were not colliding in the last one.
+	bool RecordContact(GameObject* pFirst, GameObject* pSecond);
+
+	// Returns true if the object is active, in the current scene, and in the area.
+	// Collidable objects are in the area if their shape intersects it.
+	// Other objects are in the area if their position is.
+	bool IsInArea(GameObject* pObject, const IShape2D& area) const;
+
+	// Puts the objects in the area into "results", as FindObjectsInRadius.
+	// "bounds" must enclose the area. If "pType" is not nullptr, only objects of that type are found.
+	int FindObjectsInArea(const IShape2D& area, const Rectangle2D& bounds, const ObjectType* pType,
+		GameObject** results, int maxResults);
+
+	// Returns the key in m_contacts for two objects. "first" must have the lower index.
+	static unsigned long long ContactKey(ObjectHandle first, ObjectHandle second);
+
+	// Removes the contacts that did not collide in this ProcessCollisions, and calls
+	// OnCollisionExit for both objects in each of them
+	void EndContacts();
+
+	// Tests m_collisionPairs on the job system, then calls ProcessCollision on this thread
+	// for each collision in the order of the pairs.
+	// All pairs are tested before any ProcessCollision is called, so objects moved
+	// by ProcessCollision are not retested this frame.
+	void ProcessCollisionPairsInParallel();
+
+	// Tests every pair of m_activeColliders, as BRUTEFORCE.
+	// Circles and rectangles that are not swept are tested against many circles and rectangles
+	// at a time using m_shapeBatch. Collisions are reported in the same order as testing each pair in turn.
+	void ProcessCollisionsBruteForce();
+
+	// Adds to m_colliderHits the batched circles, or rectangles if "circles" is false,
+	// that come after "collider" in m_activeColliders and that its shape intersects.
+	// The collider's shape must be a circle or a rectangle.
+	void FindBatchHits(int collider, bool circles);
+
+	// Deletes the object, returning it to its pool if it has one
+	void DestroyObject(GameObject* pObject);
+
+	// Gives the object a slot in the handle table, and returns its handle
+	ObjectHandle AllocateHandle(GameObject* pObject);
+
+	// Frees the handle's slot, so the handle and any copies of it no longer resolve
+	void ReleaseHandle(ObjectHandle handle);
+
+	// Returns the list of objects of a type in the scene, creating it if needed
+	std::vector<GameObject*>& GetTypeList(ScenePartition& scene, ObjectType type);
 
 	// Renders information about the current debug target
 	void RenderDebugObject();
@@ -31,16 +283,108 @@ public:
 
 	static ObjectManager instance;
 
+	// Creates a new object of type T, using memory from a pool kept for that type.
+	// Use this instead of "new" for objects that are created and deleted often,
+	// such as bullets and explosions. The object still needs to be added using AddItem.
+	// The ObjectManager will return it to the pool when it is deleted.
+	// May be called from a thread-safe Update() running on a worker thread.
+	// Parameters:
+	//  args - passed to T's constructor
+	template<typename T, typename... Args>
+	T* Create(Args&&... args)
+	{
+		// The pools only guarantee the normal alignment
+		if (alignof(T) > alignof(std::max_align_t))
+			return new T(std::forward<Args>(args)...);
+
+		ObjectPool& pool = GetPool<T>();
+		T* pObject = new (pool.Allocate()) T(std::forward<Args>(args)...);
+		static_cast<GameObject*>(pObject)->m_pPool = &pool;
+		return pObject;
+	}
+
+	// Returns the object that a handle refers to.
+	// Returns nullptr if the handle is null or the object has been deleted.
+	// Objects that have been deactivated, but not yet deleted, are still returned.
+	GameObject* Resolve(ObjectHandle handle) const;
+
+	// Adds the statistics of each pool used by Create to the end of "results"
+	void GetPoolStatistics(std::vector<PoolStatistics>& results) const;
+
 	// Returns a pointer to the closest active object of a given type to 
 	// the specified location in the currentScene
 	GameObject* FindClosestObject(Vector2D location, ObjectType ot);
 
-	// Returns a pointer to the closest active object of a given type to 
-// the specified location in the currentScene
-	std::vector<GameObject*> GetAllObjectsOfType(ObjectType ot);
+	// Finds the "k" closest active objects of a given type to the location in the current scene,
+	// without allocating memory for the results.
+	// Parameters:
+	//  location - the point to measure from, to each object's position
+	//  ot - the type of object to find
+	//  k - the most objects to find
+	//  results - an array of at least "k" elements. The objects found are put in this, closest first.
+	// Returns the number of objects put in "results". This is less than "k" if there are not enough objects.
+	int FindKNearestObjects(Vector2D location, ObjectType ot, int k, GameObject** results);
+
+	// Finds all active objects in the current scene that are in the region.
+	// Collidable objects are found if their collision shape intersects the region.
+	// Other objects are found if their position is in the region.
+	// Parameters:
+	//  region - the area to search
+	//  results - the objects found are added to the end of this
+	void FindObjectsInRegion(const Rectangle2D& region, std::vector<GameObject*>& results);
+
+	// Finds all active collidable objects in the current scene whose collision
+	// shape intersects the segment.
+	// Parameters:
+	//  segment - the line to search along
+	//  results - the objects found are added to the end of this, in order of distance along the segment
+	//            from its start. (Measured to each object's bounding box, so this is approximate.)
+	void FindObjectsAlongSegment(const Segment2D& segment, std::vector<GameObject*>& results);
+
+	// Finds active objects in the current scene within "radius" of "centre", without allocating memory.
+	// Collidable objects are found if their collision shape intersects the circle.
+	// Other objects are found if their position is in the circle.
+	// Parameters:
+	//  centre, radius - the area to search
+	//  results - an array to put the objects found in, in no particular order
+	//  maxResults - the size of the array. The search stops when it is full.
+	// Returns the number of objects put in "results"
+	int FindObjectsInRadius(Vector2D centre, double radius, GameObject** results, int maxResults);
+
+	// As above, but only finds objects of type "ot"
+	int FindObjectsInRadius(Vector2D centre, double radius, ObjectType ot, GameObject** results, int maxResults);
+
+	// Finds active objects in the current scene that are in the region, without allocating memory.
+	// Objects are found in the same way as FindObjectsInRadius.
+	// Returns the number of objects put in "results"
+	int FindObjectsInRegion(const Rectangle2D& region, GameObject** results, int maxResults);
+
+	// As above, but only finds objects of type "ot"
+	int FindObjectsInRegion(const Rectangle2D& region, ObjectType ot, GameObject** results, int maxResults);
+
+	// Finds the first active collidable object in the current scene that the segment hits,
+	// going from its start to its end, without allocating memory.
+	// Parameters:
+	//  segment - the line to search along
+	//  fraction - set to how far along the segment the object is hit, from 0 at the start to 1 at the end
+	//  mask - only finds objects with a collision category in this mask
+	// Returns nullptr if nothing is hit
+	GameObject* FindFirstObjectAlongSegment(const Segment2D& segment, double& fraction, unsigned int mask = ALLCOLLISIONCATEGORIES);
+
+	// Returns all objects of a given type in the current scene, including inactive
+	// objects that have not been deleted yet. They are in no particular order.
+	// Objects that change scene during UpdateAll are moved at the end of UpdateAll.
+	// The view is invalidated by the next call to UpdateAll, RenderAll, ProcessCollisions
+	// or DeleteInactiveItems. It can be used during an object's Update(), since objects
+	// are only added and removed once all updates have finished.
+	ObjectView GetAllObjectsOfType(ObjectType ot);
 
 	// Adds a new item to the list of objects in the current scene.
 	// Note: 
+	// The object is queued and added at the start and end of UpdateAll, at the start of
+	// ProcessCollisions and RenderAll, and in DeleteInactiveItems. Until then it will not be
+	// updated, drawn or found by searches. This makes it safe to call from
+	// thread-safe updates, and while the ObjectManager is going through its lists.
 	// This function sets the GameObject's scene.
 	// If you want to use a different scene, set it after using this function
 	// Parameters:
@@ -65,9 +409,40 @@ public:
 	void RenderAll();
 
 	// Checks for collisions between all objects in the current scene.
-	// If any collide, ProcessCollision will be called for both objects
+	// If any collide, ProcessCollision will be called for both objects, followed by
+	// OnCollisionEnter if they were not colliding last time, or OnCollisionStay if they were.
+	// Then OnCollisionExit is called for both objects of each pair that were colliding
+	// last time but are not now.
+	// Collision shapes are copied once, before any ProcessCollision is called. An object
+	// moved by ProcessCollision is still tested at the position it had when the check began,
+	// and is not tested at its new position until the next call.
 	void ProcessCollisions();
 
+	// Only valid during ProcessCollision. Returns when in the last frame the two objects first
+	// touched, as a fraction of their movement: 0 at the start of the frame, 1 at the end.
+	// This is 1 unless one of them uses continuous collision detection.
+	double GetCollisionTime() const;
+
+	// Sets the method used to find objects that might be colliding, before
+	// their collision shapes are tested in detail. The default is SPATIALHASH.
+	// BRUTEFORCE tests every pair of objects and can be used to check
+	// that the other methods give the same results.
+	// This can be changed at any time, even in the middle of a game.
+	void SetBroadphase(BroadphaseType type);
+
+	// Returns the method used to find objects that might be colliding
+	BroadphaseType GetBroadphase() const;
+
+	// Sets the size of the cells used by the SPATIALHASH broadphase in the given scene.
+	// This should be roughly the size of a typical collidable object in that scene.
+	// Parameters:
+	//  sceneNumber - the scene that will use this cell size
+	//  cellSize - the width and height of each cell in world units. Must be positive.
+	void SetCellSize(int sceneNumber, double cellSize);
+
+	// Returns the spatial hash cell size used by the given scene
+	double GetCellSize(int sceneNumber) const;
+
 	// Deletes all objects in all scenes
 	void DeleteAllObjects();			// Are you sure? (Y/N)
 
@@ -0,0 +1,79 @@
+#include "ObjectPool.h"
+#include <new>
+
+ObjectPool::ObjectPool(size_t slotSize, const char* name, int slotsPerSlab)
+{
+	// Each slot must be able to hold a free list pointer, and must keep the
+	// next slot aligned as well as the first
+	const size_t alignment = alignof(std::max_align_t);
+	if (slotSize < sizeof(FreeSlot))
+		slotSize = sizeof(FreeSlot);
+	m_slotSize = (slotSize + alignment - 1) / alignment * alignment;
+
+	m_name = name;
+	m_slotsPerSlab = (slotsPerSlab > 0) ? slotsPerSlab : DEFAULTSLOTSPERSLAB;
+	m_pFreeList = nullptr;
+	m_inUse = 0;
+	m_highWaterMark = 0;
+}
+
+ObjectPool::~ObjectPool()
+{
+	for (char* pSlab : m_slabs)
+	{
+		::operator delete(pSlab);
+	}
+}
+
+void* ObjectPool::Allocate()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_pFreeList)
+		AddSlab();
+
+	FreeSlot* pSlot = m_pFreeList;
+	m_pFreeList = pSlot->pNext;
+
+	++m_inUse;
+	if (m_inUse > m_highWaterMark)
+		m_highWaterMark = m_inUse;
+	return pSlot;
+}
+
+void ObjectPool::Free(void* pSlot)
+{
+	if (pSlot)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		FreeSlot* pFree = static_cast<FreeSlot*>(pSlot);
+		pFree->pNext = m_pFreeList;
+		m_pFreeList = pFree;
+		--m_inUse;
+	}
+}
+
+PoolStatistics ObjectPool::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	PoolStatistics stats;
+	stats.name = m_name;
+	stats.slotSize = m_slotSize;
+	stats.inUse = m_inUse;
+	stats.capacity = (int)m_slabs.size() * m_slotsPerSlab;
+	stats.highWaterMark = m_highWaterMark;
+	return stats;
+}
+
+void ObjectPool::AddSlab()
+{
+	char* pSlab = static_cast<char*>(::operator new(m_slotSize * m_slotsPerSlab));
+	m_slabs.push_back(pSlab);
+
+	// Link in reverse, so the slots are handed out in address order
+	for (int i = m_slotsPerSlab - 1; i >= 0; --i)
+	{
+		FreeSlot* pSlot = reinterpret_cast<FreeSlot*>(pSlab + i * m_slotSize);
+		pSlot->pNext = m_pFreeList;
+		m_pFreeList = pSlot;
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <mutex>
+
+// Statistics about the use of an ObjectPool
+struct PoolStatistics
+{
+	const char* name;		// Name of the type stored in the pool
+	size_t slotSize;		// Size of each slot in bytes
+	int inUse;				// Number of slots currently holding an object
+	int capacity;			// Number of slots allocated, in use or not
+	int highWaterMark;		// The largest number of slots that have been in use at once
+};
+
+// Supplies memory for objects of a single size, to avoid using the general
+// heap each time an object is created or deleted.
+// Memory is allocated in "slabs" of many slots. Slots are reused once freed,
+// most recently freed first, and slabs are not released until the pool is destroyed.
+// The pool only provides memory. The caller must construct and destroy the objects.
+// All functions may be called from any thread.
+class ObjectPool
+{
+public:
+	// Number of slots in each slab, unless otherwise specified
+	static const int DEFAULTSLOTSPERSLAB = 64;
+
+	// "slotSize" - the size of the objects to be stored
+	// "name" - used in statistics. Must remain valid for the life of the pool.
+	// "slotsPerSlab" - the number of slots allocated at a time
+	ObjectPool(size_t slotSize, const char* name, int slotsPerSlab = DEFAULTSLOTSPERSLAB);
+	~ObjectPool();
+	ObjectPool(const ObjectPool& other) = delete;
+	ObjectPool& operator=(const ObjectPool& other) = delete;
+
+	// Returns memory for one object. Allocates a new slab if all slots are in use.
+	void* Allocate();
+
+	// Returns a slot to the pool. "pSlot" must have come from Allocate() on this pool.
+	void Free(void* pSlot);
+
+	// Returns the current statistics
+	PoolStatistics GetStatistics() const;
+
+private:
+	// Unused slots hold a pointer to the next unused slot
+	struct FreeSlot
+	{
+		FreeSlot* pNext;
+	};
+
+	const char* m_name;
+	size_t m_slotSize;
+	int m_slotsPerSlab;
+	std::vector<char*> m_slabs;
+	FreeSlot* m_pFreeList;			// The first unused slot
+	int m_inUse;
+	int m_highWaterMark;
+	mutable std::mutex m_mutex;		// Protects all of the above, since objects may be created on worker threads
+
+	// Allocates a new slab and adds all its slots to the free list
+	void AddSlab();
+};
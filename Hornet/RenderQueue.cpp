@@ -0,0 +1,161 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <functional>
+
+// Packs a colour into one number, so colours can be compared and sorted
+static inline Uint32 PackColour(const SDL_Color& colour)
+{
+	return (Uint32(colour.a) << 24) | (Uint32(colour.r) << 16) | (Uint32(colour.g) << 8) | Uint32(colour.b);
+}
+
+// True if the first command should be drawn before the second
+static bool DrawnBefore(const RenderCommand& first, const RenderCommand& second)
+{
+	if (first.section != second.section)
+		return first.section < second.section;
+	if (first.layer != second.layer)
+		return first.layer < second.layer;
+	if (first.pTexture != second.pTexture)
+		return std::less<SDL_Texture*>()(first.pTexture, second.pTexture);
+	// Sprites take their colour from the vertices, so reordering them by colour
+	// saves nothing. Only shapes are grouped by blend mode and draw colour.
+	if (first.type != RenderCommandType::SPRITE && second.type != RenderCommandType::SPRITE)
+	{
+		if (first.blendMode != second.blendMode)
+			return first.blendMode < second.blendMode;
+		Uint32 firstColour = PackColour(first.colour);
+		Uint32 secondColour = PackColour(second.colour);
+		if (firstColour != secondColour)
+			return firstColour < secondColour;
+	}
+	return first.sequence < second.sequence;
+}
+
+RenderQueue::RenderQueue()
+{
+	m_section = 0;
+	m_layer = 0;
+	m_layered = false;
+	m_statistics = RenderStatistics{};
+}
+
+void RenderQueue::SetLayer(int layer)
+{
+	// Start a new section, so that these commands are not mixed with earlier unlayered ones
+	if (!m_layered)
+	{
+		++m_section;
+		m_layered = true;
+	}
+	m_layer = layer;
+}
+
+void RenderQueue::ClearLayer()
+{
+	m_layered = false;
+	m_layer = 0;
+}
+
+RenderCommand& RenderQueue::Add(RenderCommandType type, SDL_Texture* pTexture, SDL_BlendMode blendMode, SDL_Color colour)
+{
+	// Without a layer, each command has a section of its own, so it keeps its place
+	if (!m_layered)
+		++m_section;
+
+	RenderCommand command = {};
+	command.section = m_section;
+	command.layer = m_layer;
+	command.pTexture = pTexture;
+	command.blendMode = blendMode;
+	command.colour = colour;
+	command.sequence = (int)m_commands.size();
+	command.type = type;
+	m_commands.push_back(command);
+	return m_commands.back();
+}
+
+int RenderQueue::AddPoints(int numPoints)
+{
+	int first = (int)m_points.size();
+	m_points.resize(m_points.size() + numPoints);
+	return first;
+}
+
+SDL_FPoint* RenderQueue::GetPoints()
+{
+	return m_points.data();
+}
+
+void RenderQueue::RemoveTexture(SDL_Texture* pTexture)
+{
+	m_commands.erase(std::remove_if(m_commands.begin(), m_commands.end(),
+		[pTexture](const RenderCommand& command) { return command.pTexture == pTexture; }),
+		m_commands.end());
+}
+
+void RenderQueue::Sort()
+{
+	m_statistics.numCommands = (int)m_commands.size();
+	m_statistics.callOrder = CountStateChanges();
+	std::sort(m_commands.begin(), m_commands.end(), DrawnBefore);
+	m_statistics.sorted = CountStateChanges();
+}
+
+const std::vector<RenderCommand>& RenderQueue::GetCommands() const
+{
+	return m_commands;
+}
+
+RenderStatistics RenderQueue::GetStatistics() const
+{
+	return m_statistics;
+}
+
+void RenderQueue::Clear()
+{
+	// Keeps the capacity of the vectors, so later frames do not need to allocate
+	m_commands.clear();
+	m_points.clear();
+	m_section = 0;
+	m_layer = 0;
+	m_layered = false;
+}
+
+StateChanges RenderQueue::CountStateChanges() const
+{
+	StateChanges changes = {};
+	bool firstCommand = true;
+	bool firstShape = true;
+	SDL_Texture* pTexture = nullptr;
+	SDL_BlendMode blendMode = SDL_BLENDMODE_NONE;
+	Uint32 colour = 0;
+
+	for (const RenderCommand& command : m_commands)
+	{
+		if (firstCommand || command.pTexture != pTexture)
+		{
+			++changes.textures;
+			pTexture = command.pTexture;
+			firstCommand = false;
+		}
+
+		// Sprites take their colour and blend mode from the texture and vertices.
+		// Only shapes use the renderer's draw colour and blend mode.
+		if (command.type != RenderCommandType::SPRITE)
+		{
+			Uint32 commandColour = PackColour(command.colour);
+			if (firstShape || command.blendMode != blendMode)
+			{
+				++changes.blendModes;
+				blendMode = command.blendMode;
+			}
+			if (firstShape || commandColour != colour)
+			{
+				++changes.colours;
+				colour = commandColour;
+			}
+			firstShape = false;
+		}
+	}
+	return changes;
+}
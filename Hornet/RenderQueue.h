@@ -0,0 +1,102 @@
+#pragma once
+#include "SDL.h"
+#include <vector>
+
+// The kinds of drawing that HtGraphics can queue
+enum class RenderCommandType { SPRITE, FILLRECT, FILLANGLEDRECT, FILLCIRCLE, SEGMENT, POINTS };
+
+// One queued drawing operation, in native (screen) coordinates.
+// Used internally by HtGraphics.
+struct RenderCommand
+{
+	// Sort key. Commands are drawn in order of section, then layer, then
+	// texture, then blend mode and colour for shapes, and finally the order they were queued.
+	int section;
+	int layer;
+	SDL_Texture* pTexture;		// nullptr for everything except sprites
+	SDL_BlendMode blendMode;
+	SDL_Color colour;			// For sprites this is the vertex colour, not the renderer's draw colour
+	int sequence;
+
+	RenderCommandType type;
+	// SPRITE - the centre and size. FILLRECT - the top left and size.
+	// FILLCIRCLE - the centre, with the radius in size.x. SEGMENT - the start, and the end minus the start.
+	SDL_FPoint position;
+	SDL_FPoint size;
+	double angle;				// SPRITE only. Clockwise in degrees
+	SDL_FRect uvArea;			// SPRITE only. The part of the texture to draw
+	int firstPoint;				// POINTS and FILLANGLEDRECT (four corners) only. Index into GetPoints()
+	int numPoints;
+};
+
+// Numbers of changes of renderer state needed to draw a list of commands
+struct StateChanges
+{
+	int textures;		// Changes of texture. Each one needs a separate draw call
+	int colours;		// Changes of draw colour between shapes
+	int blendModes;		// Changes of blend mode between shapes
+};
+
+// Information about the commands drawn in one frame
+struct RenderStatistics
+{
+	int numCommands;
+	StateChanges callOrder;	// State changes there would have been, drawing in the order of the calls
+	StateChanges sorted;	// State changes after sorting
+};
+
+// A list of drawing commands for one frame. HtGraphics adds commands when
+// the drawing functions are called, and sorts and draws them in Present().
+// Sorting groups commands that use the same texture, blend mode and colour, so that
+// the renderer changes state less often and more sprites can share a SpriteBatch.
+// Only commands in the same layer are reordered. Commands queued when no
+// layer is set are drawn in the order they were queued.
+class RenderQueue
+{
+public:
+	RenderQueue();
+
+	// Commands queued after this are in the specified layer, and can be reordered with
+	// other commands in the same run of layers. Lower layers are drawn first.
+	void SetLayer(int layer);
+
+	// Commands queued after this are drawn in the order they were queued
+	void ClearLayer();
+
+	// Adds a command and returns it, with its sort key filled in.
+	// The caller sets the other members. The reference is only valid until the next command is added.
+	RenderCommand& Add(RenderCommandType type, SDL_Texture* pTexture, SDL_BlendMode blendMode, SDL_Color colour);
+
+	// Adds space for points and returns the index of the first,
+	// for the firstPoint member of a command
+	int AddPoints(int numPoints);
+
+	// Returns the points used by commands
+	SDL_FPoint* GetPoints();
+
+	// Removes all commands that use the texture. Used when a texture is about to be destroyed.
+	void RemoveTexture(SDL_Texture* pTexture);
+
+	// Puts the commands into drawing order and updates the statistics
+	void Sort();
+
+	// Returns the commands, in drawing order if Sort() has been called
+	const std::vector<RenderCommand>& GetCommands() const;
+
+	// Returns information about the commands at the time Sort() was last called
+	RenderStatistics GetStatistics() const;
+
+	// Removes all commands and points, ready for the next frame
+	void Clear();
+
+private:
+	// Counts the state changes needed to draw the commands in their current order
+	StateChanges CountStateChanges() const;
+
+	std::vector<RenderCommand> m_commands;
+	std::vector<SDL_FPoint> m_points;
+	int m_section;				// Increases each time the order of commands must be kept
+	int m_layer;
+	bool m_layered;				// True if a layer is set
+	RenderStatistics m_statistics;
+};
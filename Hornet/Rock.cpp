@@ -1,7 +1,12 @@
 #include "Rock.h"
 
+// Collision category for rocks
+const unsigned int ROCKCATEGORY = 2;
+
 Rock::Rock(): GameObject(ObjectType::ROCK)
 {
+    // Update only moves this rock, so can run alongside other updates
+    SetThreadSafeUpdate();
 }
 
 void Rock::Update(double frametime)
@@ -42,4 +47,7 @@ void Rock::Initialise()
     m_speed = 40 + rand() % 111;
     m_velocity.setBearing(m_angle, m_speed);
     SetCollidable();
+
+    // Rocks pass through each other, so don't test them against other rocks
+    SetCollisionFilter(ROCKCATEGORY, ALLCOLLISIONCATEGORIES & ~ROCKCATEGORY);
 }
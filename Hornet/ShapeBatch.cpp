@@ -0,0 +1,240 @@
+#include "ShapeBatch.h"
+#include <algorithm>
+
+// Choose the widest instructions the compiler is targeting.
+// Each set provides the same operations on "Lanes", which hold LANES doubles.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SHAPEBATCH_SIMD
+typedef __m256d Lanes;
+static const int LANES = 4;
+static inline Lanes Load(const double* p) { return _mm256_loadu_pd(p); }
+static inline Lanes Set(double value) { return _mm256_set1_pd(value); }
+static inline Lanes Add(Lanes a, Lanes b) { return _mm256_add_pd(a, b); }
+static inline Lanes Sub(Lanes a, Lanes b) { return _mm256_sub_pd(a, b); }
+static inline Lanes Mul(Lanes a, Lanes b) { return _mm256_mul_pd(a, b); }
+static inline Lanes Max(Lanes a, Lanes b) { return _mm256_max_pd(a, b); }
+static inline Lanes Less(Lanes a, Lanes b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+static inline Lanes And(Lanes a, Lanes b) { return _mm256_and_pd(a, b); }
+static inline Lanes Or(Lanes a, Lanes b) { return _mm256_or_pd(a, b); }
+static inline uint32_t Mask(Lanes a) { return (uint32_t)_mm256_movemask_pd(a); }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHAPEBATCH_SIMD
+typedef __m128d Lanes;
+static const int LANES = 2;
+static inline Lanes Load(const double* p) { return _mm_loadu_pd(p); }
+static inline Lanes Set(double value) { return _mm_set1_pd(value); }
+static inline Lanes Add(Lanes a, Lanes b) { return _mm_add_pd(a, b); }
+static inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_pd(a, b); }
+static inline Lanes Mul(Lanes a, Lanes b) { return _mm_mul_pd(a, b); }
+static inline Lanes Max(Lanes a, Lanes b) { return _mm_max_pd(a, b); }
+static inline Lanes Less(Lanes a, Lanes b) { return _mm_cmplt_pd(a, b); }
+static inline Lanes And(Lanes a, Lanes b) { return _mm_and_pd(a, b); }
+static inline Lanes Or(Lanes a, Lanes b) { return _mm_or_pd(a, b); }
+static inline uint32_t Mask(Lanes a) { return (uint32_t)_mm_movemask_pd(a); }
+#endif
+
+// Single tests, used without SIMD and for the shapes left over after the last full set of lanes
+
+static inline bool CircleHitsCircle(double x1, double y1, double r1, double x2, double y2, double r2)
+{
+	double dx = x2 - x1;
+	double dy = y2 - y1;
+	double radii = r1 + r2;
+	return dx * dx + dy * dy < radii * radii;
+}
+
+static inline bool CircleHitsRectangle(double x, double y, double r,
+	double minX, double minY, double maxX, double maxY)
+{
+	// Distance from the centre to the nearest point of the rectangle on each axis
+	double dx = std::max(std::max(minX - x, x - maxX), 0.0);
+	double dy = std::max(std::max(minY - y, y - maxY), 0.0);
+
+	// A centre inside the rectangle always counts, even if the radius is zero
+	return dx * dx + dy * dy < r * r || (x > minX && x < maxX && y > minY && y < maxY);
+}
+
+static inline bool RectangleHitsRectangle(double minX1, double minY1, double maxX1, double maxY1,
+	double minX2, double minY2, double maxX2, double maxY2)
+{
+	return minX2 < maxX1 && minX1 < maxX2 && minY2 < maxY1 && minY1 < maxY2;
+}
+
+void ShapeBatch::Clear()
+{
+	m_circleX.clear();
+	m_circleY.clear();
+	m_circleRadius.clear();
+	m_rectangleMinX.clear();
+	m_rectangleMinY.clear();
+	m_rectangleMaxX.clear();
+	m_rectangleMaxY.clear();
+}
+
+void ShapeBatch::AddCircle(const Circle2D& circle)
+{
+	m_circleX.push_back(circle.GetCentre().XValue);
+	m_circleY.push_back(circle.GetCentre().YValue);
+	m_circleRadius.push_back(circle.GetRadius());
+}
+
+void ShapeBatch::AddRectangle(const Rectangle2D& rectangle)
+{
+	m_rectangleMinX.push_back(rectangle.GetBottomLeft().XValue);
+	m_rectangleMinY.push_back(rectangle.GetBottomLeft().YValue);
+	m_rectangleMaxX.push_back(rectangle.GetTopRight().XValue);
+	m_rectangleMaxY.push_back(rectangle.GetTopRight().YValue);
+}
+
+int ShapeBatch::GetNumCircles() const
+{
+	return (int)m_circleX.size();
+}
+
+int ShapeBatch::GetNumRectangles() const
+{
+	return (int)m_rectangleMinX.size();
+}
+
+uint32_t ShapeBatch::TestCircles(const Circle2D& circle, int first, int count) const
+{
+	const double x = circle.GetCentre().XValue;
+	const double y = circle.GetCentre().YValue;
+	const double r = circle.GetRadius();
+	const double* pX = m_circleX.data() + first;
+	const double* pY = m_circleY.data() + first;
+	const double* pR = m_circleRadius.data() + first;
+
+	uint32_t mask = 0;
+	int i = 0;
+#ifdef SHAPEBATCH_SIMD
+	Lanes x1 = Set(x);
+	Lanes y1 = Set(y);
+	Lanes r1 = Set(r);
+	for (; i + LANES <= count; i += LANES)
+	{
+		Lanes dx = Sub(Load(pX + i), x1);
+		Lanes dy = Sub(Load(pY + i), y1);
+		Lanes radii = Add(r1, Load(pR + i));
+		Lanes hit = Less(Add(Mul(dx, dx), Mul(dy, dy)), Mul(radii, radii));
+		mask |= Mask(hit) << i;
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		if (CircleHitsCircle(x, y, r, pX[i], pY[i], pR[i]))
+			mask |= 1u << i;
+	}
+	return mask;
+}
+
+uint32_t ShapeBatch::TestCircles(const Rectangle2D& rectangle, int first, int count) const
+{
+	const double minX = rectangle.GetBottomLeft().XValue;
+	const double minY = rectangle.GetBottomLeft().YValue;
+	const double maxX = rectangle.GetTopRight().XValue;
+	const double maxY = rectangle.GetTopRight().YValue;
+	const double* pX = m_circleX.data() + first;
+	const double* pY = m_circleY.data() + first;
+	const double* pR = m_circleRadius.data() + first;
+
+	uint32_t mask = 0;
+	int i = 0;
+#ifdef SHAPEBATCH_SIMD
+	Lanes minX1 = Set(minX);
+	Lanes minY1 = Set(minY);
+	Lanes maxX1 = Set(maxX);
+	Lanes maxY1 = Set(maxY);
+	Lanes zero = Set(0.0);
+	for (; i + LANES <= count; i += LANES)
+	{
+		Lanes x = Load(pX + i);
+		Lanes y = Load(pY + i);
+		Lanes r = Load(pR + i);
+		Lanes dx = Max(Max(Sub(minX1, x), Sub(x, maxX1)), zero);
+		Lanes dy = Max(Max(Sub(minY1, y), Sub(y, maxY1)), zero);
+		Lanes near = Less(Add(Mul(dx, dx), Mul(dy, dy)), Mul(r, r));
+		Lanes inside = And(And(Less(minX1, x), Less(x, maxX1)), And(Less(minY1, y), Less(y, maxY1)));
+		mask |= Mask(Or(near, inside)) << i;
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		if (CircleHitsRectangle(pX[i], pY[i], pR[i], minX, minY, maxX, maxY))
+			mask |= 1u << i;
+	}
+	return mask;
+}
+
+uint32_t ShapeBatch::TestRectangles(const Circle2D& circle, int first, int count) const
+{
+	const double x = circle.GetCentre().XValue;
+	const double y = circle.GetCentre().YValue;
+	const double r = circle.GetRadius();
+	const double* pMinX = m_rectangleMinX.data() + first;
+	const double* pMinY = m_rectangleMinY.data() + first;
+	const double* pMaxX = m_rectangleMaxX.data() + first;
+	const double* pMaxY = m_rectangleMaxY.data() + first;
+
+	uint32_t mask = 0;
+	int i = 0;
+#ifdef SHAPEBATCH_SIMD
+	Lanes x1 = Set(x);
+	Lanes y1 = Set(y);
+	Lanes rSquared = Set(r * r);
+	Lanes zero = Set(0.0);
+	for (; i + LANES <= count; i += LANES)
+	{
+		Lanes minX = Load(pMinX + i);
+		Lanes minY = Load(pMinY + i);
+		Lanes maxX = Load(pMaxX + i);
+		Lanes maxY = Load(pMaxY + i);
+		Lanes dx = Max(Max(Sub(minX, x1), Sub(x1, maxX)), zero);
+		Lanes dy = Max(Max(Sub(minY, y1), Sub(y1, maxY)), zero);
+		Lanes near = Less(Add(Mul(dx, dx), Mul(dy, dy)), rSquared);
+		Lanes inside = And(And(Less(minX, x1), Less(x1, maxX)), And(Less(minY, y1), Less(y1, maxY)));
+		mask |= Mask(Or(near, inside)) << i;
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		if (CircleHitsRectangle(x, y, r, pMinX[i], pMinY[i], pMaxX[i], pMaxY[i]))
+			mask |= 1u << i;
+	}
+	return mask;
+}
+
+uint32_t ShapeBatch::TestRectangles(const Rectangle2D& rectangle, int first, int count) const
+{
+	const double minX = rectangle.GetBottomLeft().XValue;
+	const double minY = rectangle.GetBottomLeft().YValue;
+	const double maxX = rectangle.GetTopRight().XValue;
+	const double maxY = rectangle.GetTopRight().YValue;
+	const double* pMinX = m_rectangleMinX.data() + first;
+	const double* pMinY = m_rectangleMinY.data() + first;
+	const double* pMaxX = m_rectangleMaxX.data() + first;
+	const double* pMaxY = m_rectangleMaxY.data() + first;
+
+	uint32_t mask = 0;
+	int i = 0;
+#ifdef SHAPEBATCH_SIMD
+	Lanes minX1 = Set(minX);
+	Lanes minY1 = Set(minY);
+	Lanes maxX1 = Set(maxX);
+	Lanes maxY1 = Set(maxY);
+	for (; i + LANES <= count; i += LANES)
+	{
+		Lanes overlapX = And(Less(Load(pMinX + i), maxX1), Less(minX1, Load(pMaxX + i)));
+		Lanes overlapY = And(Less(Load(pMinY + i), maxY1), Less(minY1, Load(pMaxY + i)));
+		mask |= Mask(And(overlapX, overlapY)) << i;
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		if (RectangleHitsRectangle(minX, minY, maxX, maxY, pMinX[i], pMinY[i], pMaxX[i], pMaxY[i]))
+			mask |= 1u << i;
+	}
+	return mask;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "Shapes.h"
+#include <vector>
+#include <cstdint>
+
+// Circles and rectangles stored as separate arrays of each coordinate
+// ("structure of arrays"), so that one shape can be tested against several
+// of them at once using SIMD instructions.
+// Uses AVX2 or SSE2 if the compiler targets them, otherwise tests one at a time.
+// Results are the same as the shapes' Intersects() functions, except possibly
+// for shapes that are exactly touching, where rounding may differ.
+class ShapeBatch
+{
+public:
+	// The most shapes that one call can test, since each result is one bit
+	static constexpr int MAXTESTS = 32;
+
+	// Removes all shapes
+	void Clear();
+
+	// Adds a circle. Circles are numbered from 0 in the order they are added.
+	void AddCircle(const Circle2D& circle);
+
+	// Adds a rectangle. Rectangles are numbered from 0 in the order they are added.
+	void AddRectangle(const Rectangle2D& rectangle);
+
+	int GetNumCircles() const;
+	int GetNumRectangles() const;
+
+	// Tests the shape against circles "first" to first+count-1.
+	// "count" must not be more than MAXTESTS.
+	// Returns a mask with bit n set if the shape intersects circle first+n.
+	uint32_t TestCircles(const Circle2D& circle, int first, int count) const;
+	uint32_t TestCircles(const Rectangle2D& rectangle, int first, int count) const;
+
+	// Tests the shape against rectangles "first" to first+count-1.
+	// "count" must not be more than MAXTESTS.
+	// Returns a mask with bit n set if the shape intersects rectangle first+n.
+	uint32_t TestRectangles(const Circle2D& circle, int first, int count) const;
+	uint32_t TestRectangles(const Rectangle2D& rectangle, int first, int count) const;
+
+private:
+	std::vector<double> m_circleX;
+	std::vector<double> m_circleY;
+	std::vector<double> m_circleRadius;
+
+	std::vector<double> m_rectangleMinX;
+	std::vector<double> m_rectangleMinY;
+	std::vector<double> m_rectangleMaxX;
+	std::vector<double> m_rectangleMaxY;
+};
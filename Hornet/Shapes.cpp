@@ -15,28 +15,84 @@ using namespace std;
 // Member functions for IShape ***********************************
 // ***************************************************************
 
+IShape2D::IShape2D(ShapeKind kind): mKind(kind)
+{
+
+}
+
 // Virtual destructor for usual reasons
 IShape2D::~IShape2D()
 {
 
 }
 
+ShapeKind IShape2D::GetKind() const
+{
+	return mKind;
+}
+
+// Calls the Intersects() function of "other" that takes the concrete type of "shape".
+// The kinds must already be known to match the template types.
+template <class Shape, class Other>
+static bool IntersectsAs(const IShape2D& shape, const IShape2D& other)
+{
+	return static_cast<const Other&>(other).Intersects(static_cast<const Shape&>(shape));
+}
+
+typedef bool (*IntersectsFunction)(const IShape2D& shape, const IShape2D& other);
+
+// Gives the function to use for each pair of kinds.
+// Indexed by the kind of the shape, then the kind of the other shape,
+// in the order they are listed in ShapeKind.
+template <class Shape>
+struct IntersectsRow
+{
+	IntersectsFunction functions[NUMSHAPEKINDS] =
+	{
+		IntersectsAs<Shape, Point2D>,
+		IntersectsAs<Shape, Segment2D>,
+		IntersectsAs<Shape, Circle2D>,
+		IntersectsAs<Shape, Rectangle2D>,
+		IntersectsAs<Shape, AngledRectangle2D>
+	};
+};
+
+static const IntersectsRow<Point2D> POINTROW;
+static const IntersectsRow<Segment2D> SEGMENTROW;
+static const IntersectsRow<Circle2D> CIRCLEROW;
+static const IntersectsRow<Rectangle2D> RECTANGLEROW;
+static const IntersectsRow<AngledRectangle2D> ANGLEDRECTANGLEROW;
+
+static const IntersectsFunction* const INTERSECTSTABLE[NUMSHAPEKINDS] =
+{
+	POINTROW.functions,
+	SEGMENTROW.functions,
+	CIRCLEROW.functions,
+	RECTANGLEROW.functions,
+	ANGLEDRECTANGLEROW.functions
+};
+
+bool IShape2D::IntersectsByKind(const IShape2D& other) const
+{
+	return INTERSECTSTABLE[(int)mKind][(int)other.mKind](*this, other);
+}
+
 
 // ***************************************************************
 // Member functions for Point2D **********************************
 // ***************************************************************
 
-Point2D::Point2D()
+Point2D::Point2D(): IShape2D(ShapeKind::POINT)
 {
 	this->mPosition.set(0,0);
 }
 
-Point2D::Point2D(double x, double y)
+Point2D::Point2D(double x, double y): IShape2D(ShapeKind::POINT)
 {
 	this->mPosition.set(x,y);
 }
 
-Point2D::Point2D(const Vector2D &copy)
+Point2D::Point2D(const Vector2D &copy): IShape2D(ShapeKind::POINT)
 {
 	this->mPosition=copy;
 }
@@ -81,31 +137,12 @@ bool Point2D::Intersects(const Segment2D &other) const
 
 bool Point2D::Intersects(const IShape2D& other) const
 {
-	// Is it a rectangle?
-	if (typeid(other) == typeid(Rectangle2D))
-		return dynamic_cast<const Rectangle2D*> (&other)->Intersects(*this);
-
-	// Is it a circle?
-	if (typeid(other) == typeid(Circle2D))
-		return dynamic_cast<const Circle2D*> (&other)->Intersects(*this);
-
-	// Is it a segment?
-	if (typeid(other) == typeid(Segment2D))
-		return dynamic_cast<const Segment2D*> (&other)->Intersects(*this);
-
-	// Is it a point?
-	if (typeid(other) == typeid(Point2D))
-		return dynamic_cast<const Point2D*> (&other)->Intersects(*this);
-
-	// Is it a point?
-	if (typeid(other) == typeid(Rectangle2D))
-		return dynamic_cast<const Rectangle2D*> (&other)->Intersects(*this);
-
-	// Is it an angled rectangle?
-	if (typeid(other) == typeid(AngledRectangle2D))
-		return dynamic_cast<const AngledRectangle2D*> (&other)->Intersects(*this);
+	return IntersectsByKind(other);
+}
 
-	return false;
+Rectangle2D Point2D::GetBoundingBox() const
+{
+	return Rectangle2D(mPosition, mPosition);
 }
 
 double Point2D::Distance(const Segment2D &other) const
@@ -232,7 +269,7 @@ Vector2D Point2D::Intersection(const Rectangle2D &other) const
 // Member functions for Segment2D *********************************
 // ****************************************************************
 
-Segment2D::Segment2D(): mStart(0,0), mEnd(0,0)
+Segment2D::Segment2D(): IShape2D(ShapeKind::SEGMENT), mStart(0,0), mEnd(0,0)
 {
 
 }
@@ -309,33 +346,13 @@ Vector2D Segment2D::Intersection(const Point2D &other) const
 
 bool Segment2D::Intersects(const IShape2D& other) const
 {
-	// Is it a rectangle?
-	if (typeid(other) == typeid(Rectangle2D))
-		return dynamic_cast<const Rectangle2D*> (&other)->Intersects(*this);
-
-	// Is it a circle?
-	if (typeid(other) == typeid(Circle2D))
-		return dynamic_cast<const Circle2D*> (&other)->Intersects(*this);
-
-	// Is it a segment?
-	if (typeid(other) == typeid(Segment2D))
-		return dynamic_cast<const Segment2D*> (&other)->Intersects(*this);
-
-	// Is it a point?
-	if (typeid(other) == typeid(Point2D))
-		return dynamic_cast<const Point2D*> (&other)->Intersects(*this);
-
-	// Is it a point?
-	if (typeid(other) == typeid(Rectangle2D))
-		return dynamic_cast<const Rectangle2D*> (&other)->Intersects(*this);
-
-	// Is it an angled rectangle?
-	if (typeid(other) == typeid(AngledRectangle2D))
-		return dynamic_cast<const AngledRectangle2D*> (&other)->Intersects(*this);
-
-	// Undefined shape
-	return false;
+	return IntersectsByKind(other);
+}
 
+Rectangle2D Segment2D::GetBoundingBox() const
+{
+	// PlaceAt sorts the corners, so the ends can be passed in any order
+	return Rectangle2D(mStart, mEnd);
 }
 
 bool Segment2D::Intersects(const Segment2D &other) const
@@ -625,12 +642,12 @@ void Segment2D::SetEndTo(double t)
 // Member functions for Circle2D
 // *********************************************************************
 
-Circle2D::Circle2D(): mdRadius(0)
+Circle2D::Circle2D(): IShape2D(ShapeKind::CIRCLE), mdRadius(0)
 {
 	this->mCentre.set(0,0);
 }
 
-Circle2D::Circle2D(const Vector2D &centre, double radius)
+Circle2D::Circle2D(const Vector2D &centre, double radius): IShape2D(ShapeKind::CIRCLE)
 {
 	this->mCentre=centre;
 	if(radius>=0)
@@ -690,32 +707,13 @@ bool Circle2D::Intersects(const Segment2D &other) const
 
 bool Circle2D::Intersects(const IShape2D& other) const
 {
-	// Is it a rectangle?
-	if(typeid(other)==typeid(Rectangle2D))
-		return dynamic_cast<const Rectangle2D*> (&other)->Intersects(*this);
-
-	// Is it a circle?
-	if (typeid(other) == typeid(Circle2D))
-		return dynamic_cast<const Circle2D*> (&other)->Intersects(*this);
-
-	// Is it a segment?
-	if (typeid(other) == typeid(Segment2D))
-		return dynamic_cast<const Segment2D*> (&other)->Intersects(*this);
-
-	// Is it a point?
-	if (typeid(other) == typeid(Point2D))
-		return dynamic_cast<const Point2D*> (&other)->Intersects(*this);
-
-	// Is it a point?
-	if (typeid(other) == typeid(Rectangle2D))
-		return dynamic_cast<const Rectangle2D*> (&other)->Intersects(*this);
-
-	// Is it an angled rectangle?
-	if (typeid(other) == typeid(AngledRectangle2D))
-		return dynamic_cast<const AngledRectangle2D*> (&other)->Intersects(*this);
+	return IntersectsByKind(other);
+}
 
-	// Undefined shape
-	return false;
+Rectangle2D Circle2D::GetBoundingBox() const
+{
+	Vector2D halfSize(mdRadius, mdRadius);
+	return Rectangle2D(mCentre - halfSize, mCentre + halfSize);
 }
 
 double Circle2D::Distance(const Segment2D &other) const
@@ -789,17 +787,168 @@ Vector2D Circle2D::CollisionNormal(const Segment2D& other) const
 	return (other.Intersection(*this)-mCentre).unitVector();
 }
 
+// Returns the first time from 0 to 1 at which a point moving from "start"
+// by "movement" is inside the box, or a negative number if it never is
+static double PointEntersBox(const Vector2D& start, const Vector2D& movement,
+	double minX, double minY, double maxX, double maxY)
+{
+	double tMin = 0.0;
+	double tMax = 1.0;
+
+	const double starts[2] = { start.XValue, start.YValue };
+	const double deltas[2] = { movement.XValue, movement.YValue };
+	const double mins[2] = { minX, minY };
+	const double maxes[2] = { maxX, maxY };
+
+	// Clip the path against each pair of parallel sides in turn
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		if (std::fabs(deltas[axis]) < 1e-12)
+		{
+			// Parallel to these sides, so must already be between them
+			if (starts[axis] < mins[axis] || starts[axis] > maxes[axis])
+				return -1.0;
+		}
+		else
+		{
+			double t1 = (mins[axis] - starts[axis]) / deltas[axis];
+			double t2 = (maxes[axis] - starts[axis]) / deltas[axis];
+			if (t1 > t2)
+				std::swap(t1, t2);
+			tMin = std::max(tMin, t1);
+			tMax = std::min(tMax, t2);
+			if (tMin > tMax)
+				return -1.0;
+		}
+	}
+	return tMin;
+}
+
+// Returns the first time from 0 to 1 at which a point moving from "start"
+// by "movement" is within "radius" of "centre", or a negative number if it never is
+static double PointEntersCircle(const Vector2D& start, const Vector2D& movement,
+	const Vector2D& centre, double radius)
+{
+	Vector2D offset = start - centre;
+	double c = offset * offset - radius * radius;
+	if (c <= 0)
+		return 0.0;		// Already inside
+
+	// Solve |offset + t * movement| = radius for the smaller t
+	double a = movement * movement;
+	double b = offset * movement;
+	if (a == 0 || b >= 0)
+		return -1.0;	// Not moving, or moving away
+	double discriminant = b * b - a * c;
+	if (discriminant < 0)
+		return -1.0;
+	double t = (-b - sqrt(discriminant)) / a;
+	return (t <= 1.0) ? t : -1.0;
+}
+
+// Sweeps a circle of the given radius, with its centre moving from "start" by "movement",
+// against a box. The same as Circle2D::Sweep().
+static bool SweepCircleAgainstBox(const Vector2D& start, const Vector2D& movement, double radius,
+	double minX, double minY, double maxX, double maxY, double& time)
+{
+	// The circle touches the box when its centre is inside the box grown by the radius.
+	// With its rounded corners, that is two crossed rectangles and a circle at each corner.
+	double first = -1.0;
+	auto earliest = [&first](double t)
+		{
+			if (t >= 0 && (first < 0 || t < first))
+				first = t;
+		};
+	earliest(PointEntersBox(start, movement, minX - radius, minY, maxX + radius, maxY));
+	earliest(PointEntersBox(start, movement, minX, minY - radius, maxX, maxY + radius));
+	earliest(PointEntersCircle(start, movement, Vector2D(minX, minY), radius));
+	earliest(PointEntersCircle(start, movement, Vector2D(minX, maxY), radius));
+	earliest(PointEntersCircle(start, movement, Vector2D(maxX, minY), radius));
+	earliest(PointEntersCircle(start, movement, Vector2D(maxX, maxY), radius));
+
+	if (first < 0)
+		return false;
+	time = first;
+	return true;
+}
+
+bool Circle2D::Sweep(const Vector2D& movement, const Point2D& other, double& time) const
+{
+	double t = PointEntersCircle(mCentre, movement, other.mPosition, mdRadius);
+	if (t < 0)
+		return false;
+	time = t;
+	return true;
+}
+
+bool Circle2D::Sweep(const Vector2D& movement, const Segment2D& other, double& time) const
+{
+	double length = other.GetLength();
+	if (length == 0)
+		return Sweep(movement, Point2D(other.mStart), time);
+
+	// Work along and across the segment, so it becomes a box with no height
+	Vector2D along = (other.mEnd - other.mStart) / length;
+	Vector2D across = along.perpendicularVector();
+	Vector2D offset = mCentre - other.mStart;
+	Vector2D localStart(offset * along, offset * across);
+	Vector2D localMovement(movement * along, movement * across);
+	return SweepCircleAgainstBox(localStart, localMovement, mdRadius, 0, 0, length, 0, time);
+}
+
+bool Circle2D::Sweep(const Vector2D& movement, const Circle2D& other, double& time) const
+{
+	double t = PointEntersCircle(mCentre, movement, other.mCentre, mdRadius + other.mdRadius);
+	if (t < 0)
+		return false;
+	time = t;
+	return true;
+}
+
+bool Circle2D::Sweep(const Vector2D& movement, const Rectangle2D& other, double& time) const
+{
+	return SweepCircleAgainstBox(mCentre, movement, mdRadius, other.mCorner1.XValue, other.mCorner1.YValue,
+		other.mCorner2.XValue, other.mCorner2.YValue, time);
+}
+
+bool Circle2D::Sweep(const Vector2D& movement, const AngledRectangle2D& other, double& time) const
+{
+	// Work in the rectangle's own coordinates, where it is not rotated
+	Vector2D localStart = other.TransformToLocal(mCentre);
+	Vector2D localMovement = movement.rotatedBy(-other.mAngle);
+	const Rectangle2D& box = other.mLocalRectangle;
+	return SweepCircleAgainstBox(localStart, localMovement, mdRadius, box.mCorner1.XValue, box.mCorner1.YValue,
+		box.mCorner2.XValue, box.mCorner2.YValue, time);
+}
+
+bool Circle2D::Sweep(const Vector2D& movement, const IShape2D& other, double& time) const
+{
+	switch (other.GetKind())
+	{
+	case ShapeKind::POINT:
+		return Sweep(movement, static_cast<const Point2D&>(other), time);
+	case ShapeKind::SEGMENT:
+		return Sweep(movement, static_cast<const Segment2D&>(other), time);
+	case ShapeKind::CIRCLE:
+		return Sweep(movement, static_cast<const Circle2D&>(other), time);
+	case ShapeKind::RECTANGLE:
+		return Sweep(movement, static_cast<const Rectangle2D&>(other), time);
+	default:
+		return Sweep(movement, static_cast<const AngledRectangle2D&>(other), time);
+	}
+}
+
 
 // ********************************************************************
 // Member functions for Rectangle2D
 // ********************************************************************
 
-Rectangle2D::Rectangle2D(Vector2D bottomLeft, Vector2D topRight)
+Rectangle2D::Rectangle2D(Vector2D bottomLeft, Vector2D topRight): IShape2D(ShapeKind::RECTANGLE)
 {
 	PlaceAt(bottomLeft, topRight);
 }
 
-Rectangle2D::Rectangle2D()
+Rectangle2D::Rectangle2D(): IShape2D(ShapeKind::RECTANGLE)
 {
 	this->mCorner1.set(0,0);
 	this->mCorner2.set(0,0);
@@ -1017,32 +1166,12 @@ bool Rectangle2D::Intersects(const AngledRectangle2D &other) const
 
 bool Rectangle2D::Intersects(const IShape2D& other) const
 {
-	// Is it a rectangle?
-	if (typeid(other) == typeid(Rectangle2D))
-		return dynamic_cast<const Rectangle2D*> (&other)->Intersects(*this);
-
-	// Is it a circle?
-	if (typeid(other) == typeid(Circle2D))
-		return dynamic_cast<const Circle2D*> (&other)->Intersects(*this);
-
-	// Is it a segment?
-	if (typeid(other) == typeid(Segment2D))
-		return dynamic_cast<const Segment2D*> (&other)->Intersects(*this);
-
-	// Is it a point?
-	if (typeid(other) == typeid(Point2D))
-		return dynamic_cast<const Point2D*> (&other)->Intersects(*this);
-
-	// Is it a point?
-	if (typeid(other) == typeid(Rectangle2D))
-		return dynamic_cast<const Rectangle2D*> (&other)->Intersects(*this);
-
-	// Is it an angled rectangle?
-	if (typeid(other) == typeid(AngledRectangle2D))
-		return dynamic_cast<const AngledRectangle2D*> (&other)->Intersects(*this);
+	return IntersectsByKind(other);
+}
 
-	// Undefined shape
-	return false;
+Rectangle2D Rectangle2D::GetBoundingBox() const
+{
+	return *this;
 }
 
 
@@ -1321,7 +1450,7 @@ Vector2D Rectangle2D::CollisionNormal(const Segment2D& other) const
 
 // Angled rectangle ***************************************************
 
-AngledRectangle2D::AngledRectangle2D()
+AngledRectangle2D::AngledRectangle2D(): IShape2D(ShapeKind::ANGLEDRECTANGLE)
 {
    mWidth = 0;
    mHeight = 0;
@@ -1334,7 +1463,7 @@ AngledRectangle2D::AngledRectangle2D()
 // Constructs an AngledRectangle2D at rotation 0, with the given height
 // and width and centre
 AngledRectangle2D::AngledRectangle2D(Vector2D centre, double height, double width)
-   :mWidth(width), mHeight(height), mCentre(centre)
+   :IShape2D(ShapeKind::ANGLEDRECTANGLE), mWidth(width), mHeight(height), mCentre(centre)
 {
    UpdateTrivialRejector();
    mLocalRectangle.PlaceAt(mHeight / 2, -mWidth / 2, -mHeight / 2, mWidth / 2);
@@ -1411,32 +1540,17 @@ Vector2D AngledRectangle2D::TranformBackFromLocal(Vector2D v) const
 // Returns true if the AngledRectangle intersects with other shapes
 bool AngledRectangle2D::Intersects(const IShape2D& other) const
 {
-	// Is it a rectangle?
-	if (typeid(other) == typeid(Rectangle2D))
-		return dynamic_cast<const Rectangle2D*> (&other)->Intersects(*this);
-
-	// Is it a circle?
-	if (typeid(other) == typeid(Circle2D))
-		return dynamic_cast<const Circle2D*> (&other)->Intersects(*this);
-
-	// Is it a segment?
-	if (typeid(other) == typeid(Segment2D))
-		return dynamic_cast<const Segment2D*> (&other)->Intersects(*this);
-
-	// Is it a point?
-	if (typeid(other) == typeid(Point2D))
-		return dynamic_cast<const Point2D*> (&other)->Intersects(*this);
-
-	// Is it a point?
-	if (typeid(other) == typeid(Rectangle2D))
-		return dynamic_cast<const Rectangle2D*> (&other)->Intersects(*this);
-
-	// Is it an angled rectangle?
-	if (typeid(other) == typeid(AngledRectangle2D))
-		return dynamic_cast<const AngledRectangle2D*> (&other)->Intersects(*this);
+	return IntersectsByKind(other);
+}
 
-	// Undefined shape
-	return false;
+Rectangle2D AngledRectangle2D::GetBoundingBox() const
+{
+   // Opposite corners are reflections of each other through the centre,
+   // so the extent of two adjacent corners gives the extent of all four
+   Vector2D c1 = Vector2D(mWidth / 2, mHeight / 2).rotatedBy(mAngle);
+   Vector2D c2 = Vector2D(mWidth / 2, -mHeight / 2).rotatedBy(mAngle);
+   Vector2D halfSize(fmax(fabs(c1.XValue), fabs(c2.XValue)), fmax(fabs(c1.YValue), fabs(c2.YValue)));
+   return Rectangle2D(mCentre - halfSize, mCentre + halfSize);
 }
 
 bool AngledRectangle2D::Intersects(const Point2D& other) const
@@ -1562,4 +1676,98 @@ bool AngledRectangle2D::Intersects(const AngledRectangle2D& other) const
 
       return false;
    }
-}
\ No newline at end of file
+}
+
+
+// Shape values *******************************************************
+
+ShapeValue ToShapeValue(const IShape2D& shape)
+{
+	ShapeValue value = {};
+	value.kind = shape.GetKind();
+	switch (value.kind)
+	{
+	case ShapeKind::POINT:
+	{
+		Vector2D position = static_cast<const Point2D&>(shape).GetPosition();
+		value.values[0] = position.XValue;
+		value.values[1] = position.YValue;
+		break;
+	}
+	case ShapeKind::SEGMENT:
+	{
+		const Segment2D& segment = static_cast<const Segment2D&>(shape);
+		value.values[0] = segment.GetStart().XValue;
+		value.values[1] = segment.GetStart().YValue;
+		value.values[2] = segment.GetEnd().XValue;
+		value.values[3] = segment.GetEnd().YValue;
+		break;
+	}
+	case ShapeKind::CIRCLE:
+	{
+		const Circle2D& circle = static_cast<const Circle2D&>(shape);
+		value.values[0] = circle.GetCentre().XValue;
+		value.values[1] = circle.GetCentre().YValue;
+		value.values[2] = circle.GetRadius();
+		break;
+	}
+	case ShapeKind::RECTANGLE:
+	{
+		const Rectangle2D& rectangle = static_cast<const Rectangle2D&>(shape);
+		value.values[0] = rectangle.GetBottomLeft().XValue;
+		value.values[1] = rectangle.GetBottomLeft().YValue;
+		value.values[2] = rectangle.GetTopRight().XValue;
+		value.values[3] = rectangle.GetTopRight().YValue;
+		break;
+	}
+	case ShapeKind::ANGLEDRECTANGLE:
+	{
+		const AngledRectangle2D& rectangle = static_cast<const AngledRectangle2D&>(shape);
+		value.values[0] = rectangle.GetCentre().XValue;
+		value.values[1] = rectangle.GetCentre().YValue;
+		value.values[2] = rectangle.GetHeight();
+		value.values[3] = rectangle.GetWidth();
+		value.values[4] = rectangle.GetAngle();
+		break;
+	}
+	}
+	return value;
+}
+
+Point2D ToPoint2D(const ShapeValue& value)
+{
+	return Point2D(value.values[0], value.values[1]);
+}
+
+Segment2D ToSegment2D(const ShapeValue& value)
+{
+	Segment2D segment;
+	segment.PlaceAt(Vector2D(value.values[0], value.values[1]), Vector2D(value.values[2], value.values[3]));
+	return segment;
+}
+
+Circle2D ToCircle2D(const ShapeValue& value)
+{
+	return Circle2D(Vector2D(value.values[0], value.values[1]), value.values[2]);
+}
+
+Rectangle2D ToRectangle2D(const ShapeValue& value)
+{
+	return Rectangle2D(Vector2D(value.values[0], value.values[1]), Vector2D(value.values[2], value.values[3]));
+}
+
+AngledRectangle2D ToAngledRectangle2D(const ShapeValue& value)
+{
+	AngledRectangle2D rectangle(Vector2D(value.values[0], value.values[1]), value.values[2], value.values[3]);
+	rectangle.SetAngle(value.values[4]);
+	return rectangle;
+}
+
+bool ShapesIntersect(const ShapeValue& first, const ShapeValue& second)
+{
+	// IShape2D::Intersects calls the other shape's function, so do the same here
+	return WithShape(first, [&second](const auto& a)
+		{
+			return WithShape(second, [&a](const auto& b) { return b.Intersects(a); });
+		});
+}
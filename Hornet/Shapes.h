@@ -10,20 +10,44 @@
 #include "Vector2D.h"
 #pragma once
 
+// Predeclaration of all concrete shapes available
+class Point2D;
+class Segment2D;
+class Circle2D;
+class Rectangle2D;
+class AngledRectangle2D;
+
+// The concrete type of a shape. Used to choose which Intersects()
+// function to call without needing run-time type information.
+enum class ShapeKind { POINT, SEGMENT, CIRCLE, RECTANGLE, ANGLEDRECTANGLE };
+const int NUMSHAPEKINDS = 5;
+
 // Abstract 2D shape
 class IShape2D
 {
 public:
 	virtual bool Intersects(const IShape2D& other) const=0;
+
+	// Returns the smallest orthogonally-aligned rectangle that
+	// encloses the shape. Used to quickly reject shapes that cannot
+	// intersect before testing them properly.
+	virtual Rectangle2D GetBoundingBox() const=0;
 	virtual ~IShape2D();
-};
 
-// Predeclaration of all concrete shapes available
-class Point2D;
-class Segment2D;
-class Circle2D;
-class Rectangle2D;
-class AngledRectangle2D;
+	// Returns the concrete type of the shape
+	ShapeKind GetKind() const;
+
+protected:
+	IShape2D(ShapeKind kind);
+
+	// Returns true if this shape intersects the other, calling the
+	// Intersects() function for the concrete types of both shapes.
+	// Looks the function up in a table, rather than testing each type in turn.
+	bool IntersectsByKind(const IShape2D& other) const;
+
+private:
+	ShapeKind mKind;
+};
 
 // Class to manage a 2D point shape
 class Point2D:public IShape2D
@@ -100,6 +124,9 @@ public:
 	// Returns true if the point intersects the specified shape
 	bool Intersects(const IShape2D &other) const;
 
+	// Returns a rectangle of zero size at the location of the point
+	Rectangle2D GetBoundingBox() const;
+
 	// Returns the distance from this point to the closest 
 	// point on the rectangle.
 	// Returns a negative number if the point is within the rectangle
@@ -150,6 +177,9 @@ public:
 	// Returns true if the segment intersects the specified shape
 	bool Intersects(const IShape2D &other) const;
 
+	// Returns the rectangle with the segment as its diagonal
+	Rectangle2D GetBoundingBox() const;
+
 	// Distance from other to the closest point
 	// on the segment
 	double Distance(const Point2D &other) const;
@@ -289,6 +319,9 @@ public:
 	// Returns true if the circle intersects the specified shape
 	bool Intersects(const IShape2D &other) const;
 
+	// Returns the square that encloses the circle
+	Rectangle2D GetBoundingBox() const;
+
 	// Returns the distance from the point to the circle
 	// If the point is inside the circle,
 	// returns -ve the distance from the point to
@@ -367,6 +400,19 @@ public:
 	// collision between the other segment and
 	// this circle
 	Vector2D CollisionNormal(const Segment2D& other) const;
+
+	// Continuous collision tests. These test the circle moving from its
+	// current position by "movement", against a shape that stays still.
+	// Returns true if the circle touches the other shape at any point along
+	// the way, and sets "time" to when it first does, as a fraction of the
+	// movement. (0 if they already touch, 1 at the end of the movement.)
+	// Unlike Intersects(), shapes that are only just touching count.
+	bool Sweep(const Vector2D& movement, const Point2D& other, double& time) const;
+	bool Sweep(const Vector2D& movement, const Segment2D& other, double& time) const;
+	bool Sweep(const Vector2D& movement, const Circle2D& other, double& time) const;
+	bool Sweep(const Vector2D& movement, const Rectangle2D& other, double& time) const;
+	bool Sweep(const Vector2D& movement, const AngledRectangle2D& other, double& time) const;
+	bool Sweep(const Vector2D& movement, const IShape2D& other, double& time) const;
 };
 
 // Class to manage a 2D rectangle shape.
@@ -533,6 +579,9 @@ public:
 
 		// Returns true if the rectangle intersects the specified shape
 	bool Intersects(const IShape2D &other) const;
+
+	// Returns a copy of this rectangle
+	Rectangle2D GetBoundingBox() const;
 };
 
 
@@ -590,4 +639,54 @@ public:
    bool Intersects(const Rectangle2D& other) const;
    bool Intersects(const AngledRectangle2D& other) const;
 
-};
\ No newline at end of file
+   // Returns the orthogonally-aligned rectangle that encloses all four
+   // corners of the angled rectangle
+   Rectangle2D GetBoundingBox() const;
+};
+
+// A copy of any shape, held as plain numbers rather than as a shape object, so that
+// shapes can be stored compactly together in a contiguous array. It has no virtual functions.
+// Use WithShape() or the To...() functions to get the concrete shape back.
+struct ShapeValue
+{
+	ShapeKind kind;
+	// POINT - the position. SEGMENT - the start and end. CIRCLE - the centre and radius.
+	// RECTANGLE - the bottom left and top right corners.
+	// ANGLEDRECTANGLE - the centre, height, width and angle.
+	double values[5];
+};
+
+// Returns a copy of the shape
+ShapeValue ToShapeValue(const IShape2D& shape);
+
+// Return the shape held. The kind of the value must match.
+Point2D ToPoint2D(const ShapeValue& value);
+Segment2D ToSegment2D(const ShapeValue& value);
+Circle2D ToCircle2D(const ShapeValue& value);
+Rectangle2D ToRectangle2D(const ShapeValue& value);
+AngledRectangle2D ToAngledRectangle2D(const ShapeValue& value);
+
+// Calls function(shape) with the concrete shape held, and returns the result.
+// "function" may take a const IShape2D&, or be a generic lambda taking const auto&
+// to get the concrete type.
+template<typename Function>
+auto WithShape(const ShapeValue& value, Function function) -> decltype(function(Point2D()))
+{
+	switch (value.kind)
+	{
+	case ShapeKind::POINT:
+		return function(ToPoint2D(value));
+	case ShapeKind::SEGMENT:
+		return function(ToSegment2D(value));
+	case ShapeKind::CIRCLE:
+		return function(ToCircle2D(value));
+	case ShapeKind::RECTANGLE:
+		return function(ToRectangle2D(value));
+	default:
+		return function(ToAngledRectangle2D(value));
+	}
+}
+
+// Returns true if the two shapes intersect. Gives the same result as
+// first.Intersects(second), but calls the function for the concrete types directly.
+bool ShapesIntersect(const ShapeValue& first, const ShapeValue& second);
@@ -0,0 +1,134 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+
+const double SpatialHash::DEFAULTCELLSIZE = 256.0;
+
+// Boxes covering more cells than this are tested against every other box
+// instead of being added to the grid. Stops something like a large
+// background object from flooding the grid with entries.
+const int MAXCELLSPERBOX = 64;
+
+// Keeps cell coordinates well inside the range of an int
+const double MAXCELLCOORDINATE = 1.0e9;
+
+SpatialHash::SpatialHash()
+{
+	m_cellSize = DEFAULTCELLSIZE;
+}
+
+void SpatialHash::SetCellSize(double cellSize)
+{
+	if (cellSize > 0)
+		m_cellSize = cellSize;
+}
+
+double SpatialHash::GetCellSize() const
+{
+	return m_cellSize;
+}
+
+int SpatialHash::CellOf(double coordinate) const
+{
+	double cell = std::floor(coordinate / m_cellSize);
+	if (cell > MAXCELLCOORDINATE)
+		cell = MAXCELLCOORDINATE;
+	if (cell < -MAXCELLCOORDINATE)
+		cell = -MAXCELLCOORDINATE;
+	return int(cell);
+}
+
+long long SpatialHash::CellKey(int column, int row)
+{
+	return ((long long)column << 32) | (unsigned int)row;
+}
+
+void SpatialHash::FindPairs(const std::vector<Rectangle2D>& boxes, std::vector<CollisionPair>& pairs,
+	const CollisionFilter* pFilter)
+{
+	m_entries.clear();
+	m_oversized.clear();
+
+	size_t firstPair = pairs.size();
+
+	// Place each box in every cell it touches
+	for (int i = 0; i < (int)boxes.size(); ++i)
+	{
+		int left = CellOf(boxes[i].GetBottomLeft().XValue);
+		int right = CellOf(boxes[i].GetTopRight().XValue);
+		int bottom = CellOf(boxes[i].GetBottomLeft().YValue);
+		int top = CellOf(boxes[i].GetTopRight().YValue);
+
+		if ((long long)(right - left + 1) * (top - bottom + 1) > MAXCELLSPERBOX)
+		{
+			m_oversized.push_back(i);
+			continue;
+		}
+
+		for (int column = left; column <= right; ++column)
+		{
+			for (int row = bottom; row <= top; ++row)
+			{
+				m_entries.push_back({ CellKey(column, row), i });
+			}
+		}
+	}
+
+	// Sorting brings all the entries for each cell together
+	std::sort(m_entries.begin(), m_entries.end(),
+		[](const CellEntry& a, const CellEntry& b)
+		{
+			return a.cell < b.cell || (a.cell == b.cell && a.index < b.index);
+		});
+
+	// Check every pair of boxes within each cell
+	size_t start = 0;
+	while (start < m_entries.size())
+	{
+		size_t end = start + 1;
+		while (end < m_entries.size() && m_entries[end].cell == m_entries[start].cell)
+		{
+			++end;
+		}
+
+		for (size_t a = start; a < end; ++a)
+		{
+			const Rectangle2D& boxA = boxes[m_entries[a].index];
+			for (size_t b = a + 1; b < end; ++b)
+			{
+				const Rectangle2D& boxB = boxes[m_entries[b].index];
+				if (BoxesOverlap(boxA, boxB) && (!pFilter || pFilter->Allows(m_entries[a].index, m_entries[b].index)))
+				{
+					// Two boxes can share several cells. Only report the pair from the cell
+					// holding the bottom left corner of the area where they overlap.
+					int column = CellOf(std::max(boxA.GetBottomLeft().XValue, boxB.GetBottomLeft().XValue));
+					int row = CellOf(std::max(boxA.GetBottomLeft().YValue, boxB.GetBottomLeft().YValue));
+					if (CellKey(column, row) == m_entries[start].cell)
+					{
+						pairs.push_back({ m_entries[a].index, m_entries[b].index });
+					}
+				}
+			}
+		}
+		start = end;
+	}
+
+	// Oversized boxes are checked against everything
+	for (int oversized : m_oversized)
+	{
+		for (int i = 0; i < (int)boxes.size(); ++i)
+		{
+			// Pairs of two oversized boxes are only reported by the first of them
+			if (i == oversized ||
+				(i < oversized && std::binary_search(m_oversized.begin(), m_oversized.end(), i)))
+				continue;
+
+			if (BoxesOverlap(boxes[oversized], boxes[i]) && (!pFilter || pFilter->Allows(oversized, i)))
+			{
+				pairs.push_back({ std::min(oversized, i), std::max(oversized, i) });
+			}
+		}
+	}
+
+	std::sort(pairs.begin() + firstPair, pairs.end());
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "Broadphase.h"
+#include "Shapes.h"
+#include <vector>
+
+// A uniform grid broadphase. Each frame, every bounding box is placed into
+// all the grid cells it overlaps, and only boxes that share a cell are
+// checked against each other.
+// The cell size should be roughly the size of a typical object. If it is much
+// smaller, large objects are added to many cells. If it is much larger, many
+// objects share each cell and the grid does little to help.
+class SpatialHash
+{
+public:
+	// Sets the cell size to the default
+	SpatialHash();
+
+	// Sets the width and height of each cell in world units.
+	// Values that are zero or negative are ignored.
+	void SetCellSize(double cellSize);
+
+	// Returns the width and height of each cell in world units
+	double GetCellSize() const;
+
+	// Finds every pair of boxes that overlap and adds it to "pairs" once.
+	// Pairs are added sorted by first, then second index.
+	// "boxes" - The bounding boxes of each collider
+	// "pairs" - The pairs found. The list is not cleared first.
+	// "pFilter" - If not nullptr, pairs that the filter does not allow are left out
+	void FindPairs(const std::vector<Rectangle2D>& boxes, std::vector<CollisionPair>& pairs,
+		const CollisionFilter* pFilter = nullptr);
+
+	// The default cell size. About the size of a rock from the assets folder.
+	static const double DEFAULTCELLSIZE;
+
+private:
+	// A record that a box touches a particular cell
+	struct CellEntry
+	{
+		long long cell;		// The cell, packed by CellKey()
+		int index;			// The index of the box
+	};
+
+	double m_cellSize;
+	std::vector<CellEntry> m_entries;		// Kept between frames to avoid reallocating
+	std::vector<int> m_oversized;			// Boxes that cover too many cells to be worth placing in the grid
+
+	// Returns the column or row containing the given coordinate
+	int CellOf(double coordinate) const;
+
+	// Packs a column and row into a single sortable value
+	static long long CellKey(int column, int row);
+};
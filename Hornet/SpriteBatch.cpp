@@ -0,0 +1,81 @@
+#include "SpriteBatch.h"
+#include "Vector2D.h"
+#include <cmath>
+
+SpriteBatch::SpriteBatch()
+{
+	m_pTexture = nullptr;
+}
+
+void SpriteBatch::AddSprite(SDL_Texture* pTexture, const SDL_FRect& textureArea, float centreX, float centreY,
+	float width, float height, double angle, SDL_Color colour)
+{
+	m_pTexture = pTexture;
+
+	// Offsets of the corners from the centre, rotated clockwise on screen.
+	// Screen y points down, so the usual rotation formula turns clockwise.
+	double radians = Vector2D::DegreesToRadians(angle);
+	float cosine = (float)cos(radians);
+	float sine = (float)sin(radians);
+	float halfWidth = width / 2;
+	float halfHeight = height / 2;
+
+	// Corners in the order top left, top right, bottom right, bottom left
+	const float offsetX[4] = { -halfWidth, halfWidth, halfWidth, -halfWidth };
+	const float offsetY[4] = { -halfHeight, -halfHeight, halfHeight, halfHeight };
+	float left = textureArea.x;
+	float top = textureArea.y;
+	float right = textureArea.x + textureArea.w;
+	float bottom = textureArea.y + textureArea.h;
+	const float textureX[4] = { left, right, right, left };
+	const float textureY[4] = { top, top, bottom, bottom };
+
+	int first = (int)m_vertices.size();
+	for (int i = 0; i < 4; ++i)
+	{
+		SDL_Vertex vertex;
+		vertex.position.x = centreX + offsetX[i] * cosine - offsetY[i] * sine;
+		vertex.position.y = centreY + offsetX[i] * sine + offsetY[i] * cosine;
+		vertex.color = colour;
+		vertex.tex_coord.x = textureX[i];
+		vertex.tex_coord.y = textureY[i];
+		m_vertices.push_back(vertex);
+	}
+
+	m_indices.push_back(first);
+	m_indices.push_back(first + 1);
+	m_indices.push_back(first + 2);
+	m_indices.push_back(first);
+	m_indices.push_back(first + 2);
+	m_indices.push_back(first + 3);
+}
+
+SDL_Texture* SpriteBatch::GetTexture() const
+{
+	return m_pTexture;
+}
+
+int SpriteBatch::GetNumSprites() const
+{
+	return (int)m_vertices.size() / 4;
+}
+
+int SpriteBatch::Flush(SDL_Renderer* pRenderer)
+{
+	int result = 0;
+	if (!m_vertices.empty())
+	{
+		result = SDL_RenderGeometry(pRenderer, m_pTexture, m_vertices.data(), (int)m_vertices.size(),
+			m_indices.data(), (int)m_indices.size());
+	}
+	Clear();
+	return result;
+}
+
+void SpriteBatch::Clear()
+{
+	// Keeps the capacity of the vectors, so later frames do not need to allocate
+	m_vertices.clear();
+	m_indices.clear();
+	m_pTexture = nullptr;
+}
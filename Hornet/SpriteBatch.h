@@ -0,0 +1,45 @@
+#pragma once
+#include "SDL.h"
+#include <vector>
+
+// Collects textured quads that use the same texture, so that they can be
+// sent to the renderer with a single SDL_RenderGeometry() call instead of
+// one SDL_RenderCopyEx() each.
+// Used internally by HtGraphics. Sprites are drawn in the order they are added,
+// so HtGraphics flushes the batch whenever the texture changes or anything else
+// is drawn. This keeps the same drawing order as drawing each sprite directly.
+class SpriteBatch
+{
+public:
+	SpriteBatch();
+
+	// Adds a sprite to the batch. The texture must be the same as the
+	// texture of the sprites already in the batch (see GetTexture()), or the batch must be empty.
+	// "textureArea" - The part of the texture to draw, as fractions 0-1 of its width and height
+	// "centreX", "centreY" - The centre of the sprite in screen pixels
+	// "width", "height" - The size of the sprite in screen pixels
+	// "angle" - The rotation, clockwise in degrees
+	// "colour" - Multiplies the colours of the texture. Use opaque white to draw it unchanged,
+	//   and a lower alpha to make it transparent.
+	void AddSprite(SDL_Texture* pTexture, const SDL_FRect& textureArea, float centreX, float centreY,
+		float width, float height, double angle, SDL_Color colour);
+
+	// Returns the texture used by sprites in the batch, or nullptr if the batch is empty
+	SDL_Texture* GetTexture() const;
+
+	// Returns the number of sprites waiting to be drawn
+	int GetNumSprites() const;
+
+	// Draws all sprites in the batch with one call and empties the batch.
+	// Returns the SDL error code, which is negative on failure. Does nothing
+	// and returns 0 if the batch is empty.
+	int Flush(SDL_Renderer* pRenderer);
+
+	// Empties the batch without drawing anything
+	void Clear();
+
+private:
+	SDL_Texture* m_pTexture;			// The texture used by all sprites in the batch
+	std::vector<SDL_Vertex> m_vertices;	// Four corners for each sprite
+	std::vector<int> m_indices;			// Two triangles for each sprite
+};
@@ -0,0 +1,148 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+
+SweepAndPrune::SweepAndPrune()
+{
+	m_callNumber = 0;
+	m_numSwaps = 0;
+}
+
+void SweepAndPrune::Clear()
+{
+	m_proxies.clear();
+	m_freeProxies.clear();
+	m_proxyMap.clear();
+	m_endpoints.clear();
+	m_newEndpoints.clear();
+	m_active.clear();
+	m_numSwaps = 0;
+}
+
+int SweepAndPrune::GetNumSwaps() const
+{
+	return m_numSwaps;
+}
+
+void SweepAndPrune::FindPairs(const std::vector<GameObject*>& colliders, const std::vector<Rectangle2D>& boxes,
+	std::vector<CollisionPair>& pairs, const CollisionFilter* pFilter)
+{
+	++m_callNumber;
+	m_newEndpoints.clear();
+
+	// Match each collider to its proxy, creating proxies for new colliders
+	for (int i = 0; i < (int)colliders.size(); ++i)
+	{
+		int proxy;
+		auto it = m_proxyMap.find(colliders[i]);
+		if (it != m_proxyMap.end())
+		{
+			proxy = it->second;
+		}
+		else
+		{
+			if (m_freeProxies.empty())
+			{
+				proxy = (int)m_proxies.size();
+				m_proxies.emplace_back();
+			}
+			else
+			{
+				proxy = m_freeProxies.back();
+				m_freeProxies.pop_back();
+			}
+			m_proxies[proxy].pObject = colliders[i];
+			m_proxyMap[colliders[i]] = proxy;
+
+			m_newEndpoints.push_back({ boxes[i].GetBottomLeft().XValue, proxy, true });
+			m_newEndpoints.push_back({ boxes[i].GetTopRight().XValue, proxy, false });
+		}
+
+		Proxy& p = m_proxies[proxy];
+		p.colliderIndex = i;
+		p.lastSeen = m_callNumber;
+		p.bottom = boxes[i].GetBottomLeft().YValue;
+		p.top = boxes[i].GetTopRight().YValue;
+	}
+
+	// Forget colliders that have gone. Removing their endpoints leaves the rest in order.
+	auto gone = std::remove_if(m_endpoints.begin(), m_endpoints.end(),
+		[this](const Endpoint& e) { return m_proxies[e.proxy].lastSeen != m_callNumber; });
+	m_endpoints.erase(gone, m_endpoints.end());
+
+	for (int proxy = 0; proxy < (int)m_proxies.size(); ++proxy)
+	{
+		Proxy& p = m_proxies[proxy];
+		if (p.pObject && p.lastSeen != m_callNumber)
+		{
+			m_proxyMap.erase(p.pObject);
+			p.pObject = nullptr;
+			m_freeProxies.push_back(proxy);
+		}
+	}
+
+	// Move the endpoints that were already in the list to their new positions
+	for (Endpoint& e : m_endpoints)
+	{
+		const Rectangle2D& box = boxes[m_proxies[e.proxy].colliderIndex];
+		e.value = e.isMin ? box.GetBottomLeft().XValue : box.GetTopRight().XValue;
+	}
+
+	// Insertion sort. Most endpoints will only have moved a few places, if any.
+	m_numSwaps = 0;
+	for (size_t i = 1; i < m_endpoints.size(); ++i)
+	{
+		Endpoint moving = m_endpoints[i];
+		size_t j = i;
+		while (j > 0 && moving < m_endpoints[j - 1])
+		{
+			m_endpoints[j] = m_endpoints[j - 1];
+			--j;
+			++m_numSwaps;
+		}
+		m_endpoints[j] = moving;
+	}
+
+	// Add the endpoints of new colliders. Sorting them separately and merging
+	// avoids a slow insertion sort when many objects are added at once.
+	if (!m_newEndpoints.empty())
+	{
+		std::sort(m_newEndpoints.begin(), m_newEndpoints.end());
+		size_t oldSize = m_endpoints.size();
+		m_endpoints.insert(m_endpoints.end(), m_newEndpoints.begin(), m_newEndpoints.end());
+		std::inplace_merge(m_endpoints.begin(), m_endpoints.begin() + oldSize, m_endpoints.end());
+	}
+
+	// Sweep along the X axis. When a box starts, it overlaps on the X axis with
+	// every box that has started but not yet finished.
+	size_t firstPair = pairs.size();
+	m_active.clear();
+	for (const Endpoint& e : m_endpoints)
+	{
+		Proxy& p = m_proxies[e.proxy];
+		if (e.isMin)
+		{
+			for (int other : m_active)
+			{
+				const Proxy& q = m_proxies[other];
+				if (p.bottom <= q.top && q.bottom <= p.top
+					&& (!pFilter || pFilter->Allows(p.colliderIndex, q.colliderIndex)))
+				{
+					pairs.push_back({ std::min(p.colliderIndex, q.colliderIndex),
+						std::max(p.colliderIndex, q.colliderIndex) });
+				}
+			}
+			p.activeSlot = (int)m_active.size();
+			m_active.push_back(e.proxy);
+		}
+		else
+		{
+			// Swap with the last active proxy and remove it
+			int last = m_active.back();
+			m_active[p.activeSlot] = last;
+			m_proxies[last].activeSlot = p.activeSlot;
+			m_active.pop_back();
+		}
+	}
+
+	std::sort(pairs.begin() + firstPair, pairs.end());
+}
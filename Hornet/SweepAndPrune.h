@@ -0,0 +1,71 @@
+#pragma once
+#include "Broadphase.h"
+#include "Shapes.h"
+#include <vector>
+#include <unordered_map>
+
+class GameObject;
+
+// A sweep-and-prune broadphase. The left and right edges of every bounding
+// box are kept in a single list sorted along the X axis. The list is kept
+// between frames and re-sorted with an insertion sort, which is very fast when
+// objects have only moved a short distance since the last frame.
+// Sweeping along the list finds the boxes that overlap on the X axis, and only
+// those are checked on the Y axis.
+class SweepAndPrune
+{
+public:
+	SweepAndPrune();
+
+	// Finds every pair of boxes that overlap and adds it to "pairs" once.
+	// Pairs are added sorted by first, then second index.
+	// Objects that were in the previous call but not this one are forgotten.
+	// "colliders" - The objects that own the boxes. Used to recognise the same object from frame to frame
+	// "boxes" - The bounding boxes of each collider. boxes[i] belongs to colliders[i]
+	// "pairs" - The pairs found. The list is not cleared first.
+	// "pFilter" - If not nullptr, pairs that the filter does not allow are left out
+	void FindPairs(const std::vector<GameObject*>& colliders, const std::vector<Rectangle2D>& boxes,
+		std::vector<CollisionPair>& pairs, const CollisionFilter* pFilter = nullptr);
+
+	// Forgets all objects
+	void Clear();
+
+	// Returns the number of swaps the insertion sort needed in the last call to FindPairs.
+	// Small numbers mean that objects are moving slowly relative to each other.
+	int GetNumSwaps() const;
+
+private:
+	// The information kept about each object between frames
+	struct Proxy
+	{
+		const GameObject* pObject;	// The object, or nullptr if this proxy is not in use
+		int colliderIndex;			// Index of the object's box in the current call
+		int lastSeen;				// Number of the last call that included the object
+		int activeSlot;				// Position in m_active during the sweep
+		double bottom;				// The lower Y value of the box
+		double top;					// The upper Y value of the box
+	};
+
+	// One end of a box on the X axis
+	struct Endpoint
+	{
+		double value;				// The X value
+		int proxy;					// The proxy of the box
+		bool isMin;					// True for the left edge, false for the right
+
+		// Orders by X. At equal X left edges come first, so boxes that only touch still overlap
+		bool operator<(const Endpoint& other) const
+		{
+			return value < other.value || (value == other.value && isMin && !other.isMin);
+		}
+	};
+
+	std::vector<Proxy> m_proxies;
+	std::vector<int> m_freeProxies;							// Proxies that can be reused
+	std::unordered_map<const GameObject*, int> m_proxyMap;	// Finds the proxy used by each object
+	std::vector<Endpoint> m_endpoints;						// Sorted along the X axis
+	std::vector<Endpoint> m_newEndpoints;					// Endpoints of objects added this call
+	std::vector<int> m_active;								// Proxies whose box the sweep is currently inside
+	int m_callNumber;
+	int m_numSwaps;
+};
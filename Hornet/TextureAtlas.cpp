@@ -0,0 +1,232 @@
+#include "TextureAtlas.h"
+#include "ErrorLogger.h"
+
+// Empty pixels left around each image, so that filtering does not pick up
+// colours from neighbouring images
+const int PADDING = 1;
+
+// Images wider or taller than this fraction of a page get their own texture.
+// Large images such as backgrounds would waste most of a page and gain little from batching.
+const int LARGESTIMAGEFRACTION = 4;
+
+TextureAtlas::TextureAtlas()
+{
+	m_pRenderer = nullptr;
+	m_pageSize = PAGESIZE;
+}
+
+void TextureAtlas::Initialise(SDL_Renderer* pRenderer)
+{
+	m_pRenderer = pRenderer;
+	m_pageSize = PAGESIZE;
+
+	// Some renderers cannot make textures as large as PAGESIZE
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(pRenderer, &info) == 0)
+	{
+		if (info.max_texture_width > 0 && info.max_texture_width < m_pageSize)
+			m_pageSize = info.max_texture_width;
+		if (info.max_texture_height > 0 && info.max_texture_height < m_pageSize)
+			m_pageSize = info.max_texture_height;
+	}
+}
+
+bool TextureAtlas::Add(SDL_Surface* pImage, SDL_Texture*& pPage, SDL_Rect& area)
+{
+	int largest = m_pageSize / LARGESTIMAGEFRACTION;
+	if (!m_pRenderer || pImage->w > largest || pImage->h > largest)
+		return false;
+
+	int width = pImage->w + PADDING;
+	int height = pImage->h + PADDING;
+
+	// Try the existing pages first, newest first since older pages are usually fuller
+	int pageNumber = (int)m_pages.size() - 1;
+	int node = -1;
+	int x = 0;
+	int y = 0;
+	for (; pageNumber >= 0; --pageNumber)
+	{
+		node = FindPosition(m_pages[pageNumber], width, height, x, y);
+		if (node >= 0)
+			break;
+	}
+	if (node < 0)
+	{
+		if (!AddPage())
+			return false;
+		pageNumber = (int)m_pages.size() - 1;
+		node = FindPosition(m_pages[pageNumber], width, height, x, y);
+	}
+
+	// Pages hold 32-bit pixels with alpha. Converting also changes
+	// the colour key into transparent pixels.
+	SDL_Surface* pConverted = SDL_ConvertSurfaceFormat(pImage, SDL_PIXELFORMAT_ARGB8888, 0);
+	if (!pConverted)
+	{
+		ErrorLogger::Write("Could not convert image in TextureAtlas::Add().");
+		ErrorLogger::Write(SDL_GetError());
+		return false;
+	}
+
+	Page& page = m_pages[pageNumber];
+	area.x = x;
+	area.y = y;
+	area.w = pImage->w;
+	area.h = pImage->h;
+
+	if (SDL_MUSTLOCK(pConverted))
+		SDL_LockSurface(pConverted);
+	int result = SDL_UpdateTexture(page.pTexture, &area, pConverted->pixels, pConverted->pitch);
+	if (SDL_MUSTLOCK(pConverted))
+		SDL_UnlockSurface(pConverted);
+	SDL_FreeSurface(pConverted);
+
+	if (result < 0)
+	{
+		ErrorLogger::Write("Could not copy image to page in TextureAtlas::Add().");
+		ErrorLogger::Write(SDL_GetError());
+		return false;
+	}
+
+	Place(page, node, x, y, width, height);
+	pPage = page.pTexture;
+	return true;
+}
+
+int TextureAtlas::GetPageSize() const
+{
+	return m_pageSize;
+}
+
+int TextureAtlas::GetNumPages() const
+{
+	return (int)m_pages.size();
+}
+
+SDL_Texture* TextureAtlas::GetPage(int pageNumber) const
+{
+	return m_pages[pageNumber].pTexture;
+}
+
+void TextureAtlas::Clear()
+{
+	for (Page& page : m_pages)
+	{
+		if (page.pTexture)
+			SDL_DestroyTexture(page.pTexture);
+	}
+	m_pages.clear();
+}
+
+int TextureAtlas::FindPosition(const Page& page, int width, int height, int& x, int& y) const
+{
+	int bestNode = -1;
+	int bestY = m_pageSize;
+	int bestWidth = m_pageSize;
+
+	for (int i = 0; i < (int)page.skyline.size(); ++i)
+	{
+		int nodeY;
+		if (Fits(page, i, width, height, nodeY))
+		{
+			// Lowest position wins. If two are equally low, use the narrower
+			// step, which leaves wider steps for larger images.
+			if (nodeY < bestY || (nodeY == bestY && page.skyline[i].width < bestWidth))
+			{
+				bestNode = i;
+				bestY = nodeY;
+				bestWidth = page.skyline[i].width;
+			}
+		}
+	}
+
+	if (bestNode >= 0)
+	{
+		x = page.skyline[bestNode].x;
+		y = bestY;
+	}
+	return bestNode;
+}
+
+bool TextureAtlas::Fits(const Page& page, int node, int width, int height, int& y) const
+{
+	int x = page.skyline[node].x;
+	if (x + width > m_pageSize)
+		return false;
+
+	// The image rests on the highest step it spans
+	y = 0;
+	int widthLeft = width;
+	for (int i = node; widthLeft > 0; ++i)
+	{
+		if (page.skyline[i].y > y)
+			y = page.skyline[i].y;
+		if (y + height > m_pageSize)
+			return false;
+		widthLeft -= page.skyline[i].width;
+	}
+	return true;
+}
+
+void TextureAtlas::Place(Page& page, int node, int x, int y, int width, int height)
+{
+	SkylineNode top = { x, y + height, width };
+	page.skyline.insert(page.skyline.begin() + node, top);
+
+	// Cut back or remove the steps now underneath the image
+	int right = x + width;
+	for (int i = node + 1; i < (int)page.skyline.size();)
+	{
+		SkylineNode& step = page.skyline[i];
+		if (step.x >= right)
+			break;
+
+		int overlap = right - step.x;
+		if (overlap < step.width)
+		{
+			step.x += overlap;
+			step.width -= overlap;
+			break;
+		}
+		page.skyline.erase(page.skyline.begin() + i);
+	}
+
+	// Join neighbouring steps at the same height
+	for (int i = 0; i + 1 < (int)page.skyline.size();)
+	{
+		if (page.skyline[i].y == page.skyline[i + 1].y)
+		{
+			page.skyline[i].width += page.skyline[i + 1].width;
+			page.skyline.erase(page.skyline.begin() + i + 1);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+bool TextureAtlas::AddPage()
+{
+	Page page;
+	page.pTexture = SDL_CreateTexture(m_pRenderer, SDL_PIXELFORMAT_ARGB8888,
+		SDL_TEXTUREACCESS_STATIC, m_pageSize, m_pageSize);
+	if (!page.pTexture)
+	{
+		ErrorLogger::Write("Could not create page in TextureAtlas::AddPage().");
+		ErrorLogger::Write(SDL_GetError());
+		return false;
+	}
+
+	// The contents of a new texture are undefined, so start with
+	// every pixel transparent. This also clears the padding.
+	std::vector<Uint32> empty(m_pageSize * m_pageSize, 0);
+	SDL_UpdateTexture(page.pTexture, nullptr, empty.data(), m_pageSize * (int)sizeof(Uint32));
+	SDL_SetTextureBlendMode(page.pTexture, SDL_BLENDMODE_BLEND);
+
+	SkylineNode floor = { 0, 0, m_pageSize };
+	page.skyline.push_back(floor);
+	m_pages.push_back(page);
+	return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "SDL.h"
+#include <vector>
+
+// Packs many small images into a few large textures ("pages"), so that
+// sprites using different pictures can still share a texture and be drawn
+// in the same SpriteBatch.
+// Used internally by HtGraphics. Images are placed using a "skyline" packer,
+// which keeps track of the top edge of the images already placed on each page
+// and puts each new image as low as possible.
+// Space is not reused when a picture is released. Call Clear() to release all pages.
+class TextureAtlas
+{
+public:
+	TextureAtlas();
+
+	// Sets the renderer used to create pages. The page size is the smaller of
+	// PAGESIZE and the largest texture the renderer supports.
+	void Initialise(SDL_Renderer* pRenderer);
+
+	// Copies the image into a page, creating a new page if needed.
+	// Any colour key on the image is converted to transparency.
+	// Returns false if the image is too large to be worth packing, or the page could not
+	// be updated. In that case the image should be given its own texture.
+	// "pPage" is set to the texture of the page holding the image.
+	// "area" is set to the area of the page holding the image, in pixels.
+	bool Add(SDL_Surface* pImage, SDL_Texture*& pPage, SDL_Rect& area);
+
+	// Returns the width and height of each page in pixels
+	int GetPageSize() const;
+
+	// Returns the number of pages created so far
+	int GetNumPages() const;
+
+	// Returns the texture of the specified page, numbered from 0
+	SDL_Texture* GetPage(int pageNumber) const;
+
+	// Destroys all pages. Any textures returned by Add() are no longer valid.
+	void Clear();
+
+	// The largest page size used
+	static const int PAGESIZE = 2048;
+
+private:
+	// One step of the skyline. The images placed so far fill the page
+	// from x to x+width, up to y.
+	struct SkylineNode
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	struct Page
+	{
+		SDL_Texture* pTexture;
+		std::vector<SkylineNode> skyline;	// In order from left to right
+	};
+
+	// Finds the lowest place on the page for an image of the given size.
+	// Returns the index of the skyline node where the image starts, or -1 if it does not fit.
+	int FindPosition(const Page& page, int width, int height, int& x, int& y) const;
+
+	// Returns true if an image of the given width can start at the specified skyline node.
+	// "y" is set to the height the image would be placed at.
+	bool Fits(const Page& page, int node, int width, int height, int& y) const;
+
+	// Raises the skyline to cover an image placed at the specified node
+	void Place(Page& page, int node, int x, int y, int width, int height);
+
+	// Creates a new, empty page. Returns false if the texture could not be created
+	bool AddPage();
+
+	SDL_Renderer* m_pRenderer;
+	int m_pageSize;
+	std::vector<Page> m_pages;
+};